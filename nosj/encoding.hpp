@@ -0,0 +1,27 @@
+#ifndef ENCODING_HPP_
+#define ENCODING_HPP_
+
+
+#include <string>
+
+
+namespace nosj {
+
+
+enum class Encoding {
+	UTF8, UTF16BE, UTF16LE, UTF32BE, UTF32LE
+};
+
+// Detects the encoding of a JSON text from its byte order mark, if any, or
+// else from the pattern of null bytes in its first four bytes, as described in
+// the section "3. Encoding" of RFC 4627
+Encoding detectEncoding(const std::string&);
+
+
+}
+
+
+#include "encoding.inl"
+
+
+#endif /* ENCODING_HPP_ */
@@ -0,0 +1,498 @@
+#include <cstddef>
+#include <cstring>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+#ifdef __SSSE3__
+# include <tmmintrin.h>
+#endif
+
+
+namespace nosj {
+
+
+namespace _details {
+
+inline Encoding detectEncoding(const char* begin, const char* end, size_t& bomSize) {
+	const unsigned char* b = reinterpret_cast<const unsigned char*>(begin);
+	size_t size = end - begin;
+
+	bomSize = 0;
+	if(size >= 3  &&  b[0] == 0xEF  &&  b[1] == 0xBB  &&  b[2] == 0xBF) {
+		bomSize = 3;
+		return Encoding::UTF8;
+	} else if(size >= 4  &&  b[0] == 0x00  &&  b[1] == 0x00  &&  b[2] == 0xFE  &&  b[3] == 0xFF) {
+		bomSize = 4;
+		return Encoding::UTF32BE;
+	} else if(size >= 4  &&  b[0] == 0xFF  &&  b[1] == 0xFE  &&  b[2] == 0x00  &&  b[3] == 0x00) {
+		bomSize = 4;
+		return Encoding::UTF32LE;
+	} else if(size >= 2  &&  b[0] == 0xFE  &&  b[1] == 0xFF) {
+		bomSize = 2;
+		return Encoding::UTF16BE;
+	} else if(size >= 2  &&  b[0] == 0xFF  &&  b[1] == 0xFE) {
+		bomSize = 2;
+		return Encoding::UTF16LE;
+	}
+
+	// The first two characters of a JSON text are ASCII, so the null bytes give
+	// away the encoding:
+	//   00 00 00 xx  UTF-32BE
+	//   00 xx 00 xx  UTF-16BE
+	//   xx 00 00 00  UTF-32LE
+	//   xx 00 xx 00  UTF-16LE
+	//   xx xx xx xx  UTF-8
+	// A text of a single character has only two bytes in UTF-16.
+	if(size >= 4) {
+		if(b[0] == 0x00  &&  b[1] == 0x00  &&  b[2] == 0x00) {
+			return Encoding::UTF32BE;
+		} else if(b[0] == 0x00  &&  b[2] == 0x00) {
+			return Encoding::UTF16BE;
+		} else if(b[1] == 0x00  &&  b[2] == 0x00  &&  b[3] == 0x00) {
+			return Encoding::UTF32LE;
+		} else if(b[1] == 0x00  &&  b[3] == 0x00) {
+			return Encoding::UTF16LE;
+		}
+	} else if(size == 2) {
+		if(b[0] == 0x00) {
+			return Encoding::UTF16BE;
+		} else if(b[1] == 0x00) {
+			return Encoding::UTF16LE;
+		}
+	}
+	return Encoding::UTF8;
+}
+
+#if defined(__BYTE_ORDER__)  &&  __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+const Encoding nativeUTF16 = Encoding::UTF16BE;
+const Encoding nativeUTF32 = Encoding::UTF32BE;
+#else
+const Encoding nativeUTF16 = Encoding::UTF16LE;
+const Encoding nativeUTF32 = Encoding::UTF32LE;
+#endif
+
+// Writes the UTF-8 form of a valid code point and returns the end of it
+inline char* encodeUTF8(char32_t ch, char* out) {
+	if(ch < 0x80) {
+		*out++ = ch;
+	} else if(ch < 0x800) {
+		*out++ = 0xC0 | (ch >> 6);
+		*out++ = 0x80 | (ch & 0x3F);
+	} else if(ch < 0x10000) {
+		*out++ = 0xE0 | (ch >> 12);
+		*out++ = 0x80 | ((ch >> 6) & 0x3F);
+		*out++ = 0x80 | (ch & 0x3F);
+	} else {
+		*out++ = 0xF0 | (ch >> 18);
+		*out++ = 0x80 | ((ch >> 12) & 0x3F);
+		*out++ = 0x80 | ((ch >> 6) & 0x3F);
+		*out++ = 0x80 | (ch & 0x3F);
+	}
+	return out;
+}
+
+// Returns the end of the longest run of characters from p that need no special
+// handling in a JSON string, when it is read or written. Those are all but '"',
+// '\\', control characters and, if asciiOnly, non-ASCII bytes.
+inline const char* findStringRunEnd(const char* p, const char* end, bool asciiOnly) {
+#ifdef __SSE2__
+	const __m128i quote      = _mm_set1_epi8('"');
+	const __m128i backslash  = _mm_set1_epi8('\\');
+	const __m128i maxControl = _mm_set1_epi8(0x1F);
+	while(end - p >= 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+		special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_max_epu8(chunk, maxControl), maxControl));
+
+		int mask = _mm_movemask_epi8(special);
+		if(asciiOnly) {
+			mask |= _mm_movemask_epi8(chunk); // The high bits
+		}
+		if(mask != 0) {
+			return p + __builtin_ctz(mask);
+		}
+		p += 16;
+	}
+#endif
+
+	for(; p != end; p++) {
+		unsigned char ch = *p;
+		if(ch < 0x20  ||  ch == '"'  ||  ch == '\\'  ||  (asciiOnly  &&  ch >= 0x80)) {
+			break;
+		}
+	}
+	return p;
+}
+
+// The length of the UTF-8 sequence of the non-ASCII lead byte at p, or 0 if it
+// is invalid or cut short by end. Overlong forms, surrogates and code points
+// above U+10FFFF are invalid.
+inline size_t validUTF8SequenceLength(const char* p, const char* end) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(p);
+	unsigned char lead = bytes[0];
+	size_t length;
+	unsigned char min = 0x80;
+	unsigned char max = 0xBF;
+	if(lead >= 0xC2  &&  lead <= 0xDF) {
+		length = 2;
+	} else if(lead >= 0xE0  &&  lead <= 0xEF) {
+		length = 3;
+		if(lead == 0xE0) { min = 0xA0; }
+		if(lead == 0xED) { max = 0x9F; }
+	} else if(lead >= 0xF0  &&  lead <= 0xF4) {
+		length = 4;
+		if(lead == 0xF0) { min = 0x90; }
+		if(lead == 0xF4) { max = 0x8F; }
+	} else {
+		return 0;
+	}
+
+	if(size_t(end - p) < length) {
+		return 0;
+	}
+	for(size_t i = 1; i < length; i++) {
+		if(bytes[i] < min  ||  bytes[i] > max) {
+			return 0;
+		}
+		min = 0x80;
+		max = 0xBF;
+	}
+	return length;
+}
+
+#ifdef __SSSE3__
+// The errors of the UTF-8 sequences that go on or end in a block of 16 bytes,
+// given the block before, after Keiser and Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte". The bytes of the result are not null where a
+// sequence is invalid. Each of the first two bytes of a sequence looks up the
+// errors that its nibbles allow, and the errors that all three allow are there.
+inline __m128i checkUTF8Block(__m128i block, __m128i previous) {
+	enum : unsigned char {
+		tooShort = 1 << 0, tooLong = 1 << 1, overlong3 = 1 << 2, tooLarge = 1 << 3, surrogate = 1 << 4,
+		overlong2 = 1 << 5, tooLarge1000 = 1 << 6, overlong4 = 1 << 6, twoContinuations = 1 << 7,
+		carry = tooShort | tooLong | twoContinuations
+	};
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+
+	__m128i previous1 = _mm_alignr_epi8(block, previous, 15);
+	const __m128i byte1HighErrors = _mm_setr_epi8(
+		tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong,
+		char(twoContinuations), char(twoContinuations), char(twoContinuations), char(twoContinuations),
+		tooShort | overlong2, tooShort, tooShort | overlong3 | surrogate,
+		tooShort | tooLarge | tooLarge1000 | overlong4);
+	const __m128i byte1LowErrors = _mm_setr_epi8(
+		char(carry | overlong3 | overlong2 | overlong4), char(carry | overlong2), char(carry), char(carry),
+		char(carry | tooLarge), char(carry | tooLarge | tooLarge1000), char(carry | tooLarge | tooLarge1000),
+		char(carry | tooLarge | tooLarge1000), char(carry | tooLarge | tooLarge1000),
+		char(carry | tooLarge | tooLarge1000), char(carry | tooLarge | tooLarge1000),
+		char(carry | tooLarge | tooLarge1000), char(carry | tooLarge | tooLarge1000),
+		char(carry | tooLarge | tooLarge1000 | surrogate), char(carry | tooLarge | tooLarge1000),
+		char(carry | tooLarge | tooLarge1000));
+	const __m128i byte2HighErrors = _mm_setr_epi8(
+		tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort,
+		char(tooLong | overlong2 | twoContinuations | overlong3 | tooLarge1000 | overlong4),
+		char(tooLong | overlong2 | twoContinuations | overlong3 | tooLarge),
+		char(tooLong | overlong2 | twoContinuations | surrogate | tooLarge),
+		char(tooLong | overlong2 | twoContinuations | surrogate | tooLarge),
+		tooShort, tooShort, tooShort, tooShort);
+	__m128i errors = _mm_shuffle_epi8(byte1HighErrors, _mm_and_si128(_mm_srli_epi16(previous1, 4), nibble));
+	errors = _mm_and_si128(errors, _mm_shuffle_epi8(byte1LowErrors, _mm_and_si128(previous1, nibble)));
+	errors = _mm_and_si128(errors, _mm_shuffle_epi8(byte2HighErrors, _mm_and_si128(_mm_srli_epi16(block, 4), nibble)));
+
+	// The third and fourth bytes of the longer sequences, which must be the
+	// two continuations that the tables flag
+	__m128i third  = _mm_subs_epu8(_mm_alignr_epi8(block, previous, 14), _mm_set1_epi8(char(0xE0 - 0x80)));
+	__m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(block, previous, 13), _mm_set1_epi8(char(0xF0 - 0x80)));
+	__m128i continued = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80)));
+	return _mm_xor_si128(errors, continued);
+}
+#endif
+
+// Like findStringRunEnd(), but the run also takes the valid UTF-8 sequences,
+// and ends at the first invalid one or at one cut short by end. The blocks of
+// 16 bytes are validated at once with SSSE3, or else the runs of ASCII are
+// skipped a block at a time and the sequences are checked one by one.
+inline const char* findValidUTF8RunEnd(const char* p, const char* end) {
+#ifdef __SSSE3__
+	const char* const begin = p;
+	const __m128i quote      = _mm_set1_epi8('"');
+	const __m128i backslash  = _mm_set1_epi8('\\');
+	const __m128i maxControl = _mm_set1_epi8(0x1F);
+	const __m128i indexes    = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i previous = _mm_setzero_si128();
+	while(end - p >= 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i special = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+		special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_max_epu8(block, maxControl), maxControl));
+		int specialMask = _mm_movemask_epi8(special);
+		if(specialMask != 0) {
+			// From the first special byte on, spaces, which end the sequences
+			// before them
+			__m128i after = _mm_cmpgt_epi8(indexes, _mm_set1_epi8(char(__builtin_ctz(specialMask) - 1)));
+			block = _mm_or_si128(_mm_andnot_si128(after, block), _mm_and_si128(after, _mm_set1_epi8(' ')));
+		}
+		if((_mm_movemask_epi8(block) | _mm_movemask_epi8(previous)) != 0) {
+			__m128i errors = checkUTF8Block(block, previous);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi8(errors, _mm_setzero_si128())) != 0xFFFF) {
+				break;
+			}
+		}
+		if(specialMask != 0) {
+			return p + __builtin_ctz(specialMask);
+		}
+		previous = block;
+		p += 16;
+	}
+	// Back to the start of a sequence that the last block may have cut, or
+	// that holds the error
+	for(int i = 1; i <= 3  &&  p - i >= begin; i++) {
+		unsigned char byte = p[-i];
+		if(byte >= 0xC0) {
+			p -= i;
+			break;
+		} else if(byte < 0x80) {
+			break;
+		}
+	}
+#endif
+
+	while(true) {
+		p = findStringRunEnd(p, end, true);
+		if(p == end  ||  static_cast<unsigned char>(*p) < 0x80) {
+			return p;
+		}
+		size_t length = validUTF8SequenceLength(p, end);
+		if(length == 0) {
+			return p;
+		}
+		p += length;
+	}
+}
+
+// Decodes the UTF-8 sequence at p and moves p past it. An invalid sequence
+// becomes U+FFFD, as many bytes of it as make a valid prefix at a time.
+// Returns false without moving p if the sequence is cut short by end.
+inline bool decodeUTF8(const char*& p, const char* end, char32_t& ch) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(p);
+	unsigned char lead = bytes[0];
+	if(lead < 0x80) {
+		ch = lead;
+		p++;
+		return true;
+	}
+
+	size_t length;
+	unsigned char min = 0x80;
+	unsigned char max = 0xBF;
+	if(lead >= 0xC2  &&  lead <= 0xDF) {
+		length = 2;
+		ch = lead & 0x1F;
+	} else if(lead >= 0xE0  &&  lead <= 0xEF) {
+		length = 3;
+		ch = lead & 0x0F;
+		if(lead == 0xE0) { min = 0xA0; }
+		if(lead == 0xED) { max = 0x9F; }
+	} else if(lead >= 0xF0  &&  lead <= 0xF4) {
+		length = 4;
+		ch = lead & 0x07;
+		if(lead == 0xF0) { min = 0x90; }
+		if(lead == 0xF4) { max = 0x8F; }
+	} else {
+		ch = 0xFFFD;
+		p++;
+		return true;
+	}
+
+	for(size_t i = 1; i < length; i++) {
+		if(p + i == end) {
+			return false;
+		}
+		if(bytes[i] < min  ||  bytes[i] > max) {
+			ch = 0xFFFD;
+			p += i;
+			return true;
+		}
+		ch = (ch << 6) | (bytes[i] & 0x3F);
+		min = 0x80;
+		max = 0xBF;
+	}
+	p += length;
+	return true;
+}
+
+template <unsigned int unitSize, bool bigEndian>
+char32_t loadCodeUnit(const char* p) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(p);
+	char32_t unit = 0;
+	for(unsigned int i = 0; i < unitSize; i++) {
+		unit |= char32_t(bytes[i]) << (8 * (bigEndian ? unitSize - 1 - i : i));
+	}
+	return unit;
+}
+
+template <unsigned int unitSize, bool bigEndian>
+char* storeCodeUnit(char32_t unit, char* out) {
+	for(unsigned int i = 0; i < unitSize; i++) {
+		out[i] = (unit >> (8 * (bigEndian ? unitSize - 1 - i : i))) & 0xFF;
+	}
+	return out + unitSize;
+}
+
+// The code units of UTF-16 and UTF-32 in a given byte order, read from raw
+// bytes. load() reads a single code unit. decode() reads the code point at p and moves p past it, or returns
+// false if the code units there are not a complete and valid sequence.
+// narrowASCII() converts a block of 16 bytes of code units into 16 / size
+// chars if they are all ASCII, which is the bulk of most JSON texts.
+// encode() and widenASCII() go the other way, the latter from 16 chars.
+template <bool bigEndian>
+struct UTF16Units {
+	enum { size = 2 };
+
+	static char32_t load(const char* p) {
+		return loadCodeUnit<2, bigEndian>(p);
+	}
+
+	static bool decode(const char*& p, const char* end, char32_t& ch) {
+		if(end - p < 2) {
+			return false;
+		}
+		char32_t unit = loadCodeUnit<2, bigEndian>(p);
+		if(unit < 0xD800  ||  unit > 0xDFFF) {
+			ch = unit;
+			p += 2;
+			return true;
+		}
+		if(unit > 0xDBFF  ||  end - p < 4) {
+			return false;
+		}
+		char32_t trail = loadCodeUnit<2, bigEndian>(p + 2);
+		if(trail < 0xDC00  ||  trail > 0xDFFF) {
+			return false;
+		}
+		ch = 0x10000 + ((unit - 0xD800) << 10) + (trail - 0xDC00);
+		p += 4;
+		return true;
+	}
+
+	static char* encode(char32_t ch, char* out) {
+		if(ch < 0x10000) {
+			return storeCodeUnit<2, bigEndian>(ch, out);
+		}
+		ch -= 0x10000;
+		out = storeCodeUnit<2, bigEndian>(0xD800 + (ch >> 10), out);
+		return storeCodeUnit<2, bigEndian>(0xDC00 + (ch & 0x3FF), out);
+	}
+
+#ifdef __SSE2__
+	static bool narrowASCII(const char* p, char* out) {
+		__m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if(bigEndian) {
+			units = _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+		}
+		__m128i highBits = _mm_and_si128(units, _mm_set1_epi16(short(0xFF80)));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi16(highBits, _mm_setzero_si128())) != 0xFFFF) {
+			return false;
+		}
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(units, units));
+		return true;
+	}
+
+	static bool widenASCII(const char* p, char* out) {
+		__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if(_mm_movemask_epi8(chars) != 0) {
+			return false;
+		}
+		const __m128i zero = _mm_setzero_si128();
+		__m128i* units = reinterpret_cast<__m128i*>(out);
+		if(bigEndian) {
+			_mm_storeu_si128(units,     _mm_unpacklo_epi8(zero, chars));
+			_mm_storeu_si128(units + 1, _mm_unpackhi_epi8(zero, chars));
+		} else {
+			_mm_storeu_si128(units,     _mm_unpacklo_epi8(chars, zero));
+			_mm_storeu_si128(units + 1, _mm_unpackhi_epi8(chars, zero));
+		}
+		return true;
+	}
+#endif
+};
+
+template <bool bigEndian>
+struct UTF32Units {
+	enum { size = 4 };
+
+	static char32_t load(const char* p) {
+		return loadCodeUnit<4, bigEndian>(p);
+	}
+
+	static bool decode(const char*& p, const char* end, char32_t& ch) {
+		if(end - p < 4) {
+			return false;
+		}
+		ch = loadCodeUnit<4, bigEndian>(p);
+		if(ch > 0x10FFFF  ||  (ch >= 0xD800  &&  ch <= 0xDFFF)) {
+			return false;
+		}
+		p += 4;
+		return true;
+	}
+
+	static char* encode(char32_t ch, char* out) {
+		return storeCodeUnit<4, bigEndian>(ch, out);
+	}
+
+#ifdef __SSE2__
+	static bool narrowASCII(const char* p, char* out) {
+		__m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if(bigEndian) {
+			units = _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+			units = _mm_shufflelo_epi16(units, _MM_SHUFFLE(2, 3, 0, 1));
+			units = _mm_shufflehi_epi16(units, _MM_SHUFFLE(2, 3, 0, 1));
+		}
+		__m128i highBits = _mm_and_si128(units, _mm_set1_epi32(int(0xFFFFFF80)));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(highBits, _mm_setzero_si128())) != 0xFFFF) {
+			return false;
+		}
+		__m128i narrow = _mm_packs_epi32(units, units);
+		narrow = _mm_packus_epi16(narrow, narrow);
+		int chars = _mm_cvtsi128_si32(narrow);
+		std::memcpy(out, &chars, 4);
+		return true;
+	}
+
+	static bool widenASCII(const char* p, char* out) {
+		__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if(_mm_movemask_epi8(chars) != 0) {
+			return false;
+		}
+		const __m128i zero = _mm_setzero_si128();
+		__m128i* units = reinterpret_cast<__m128i*>(out);
+		if(bigEndian) {
+			__m128i low  = _mm_unpacklo_epi8(zero, chars);
+			__m128i high = _mm_unpackhi_epi8(zero, chars);
+			_mm_storeu_si128(units,     _mm_unpacklo_epi16(zero, low));
+			_mm_storeu_si128(units + 1, _mm_unpackhi_epi16(zero, low));
+			_mm_storeu_si128(units + 2, _mm_unpacklo_epi16(zero, high));
+			_mm_storeu_si128(units + 3, _mm_unpackhi_epi16(zero, high));
+		} else {
+			__m128i low  = _mm_unpacklo_epi8(chars, zero);
+			__m128i high = _mm_unpackhi_epi8(chars, zero);
+			_mm_storeu_si128(units,     _mm_unpacklo_epi16(low, zero));
+			_mm_storeu_si128(units + 1, _mm_unpackhi_epi16(low, zero));
+			_mm_storeu_si128(units + 2, _mm_unpacklo_epi16(high, zero));
+			_mm_storeu_si128(units + 3, _mm_unpackhi_epi16(high, zero));
+		}
+		return true;
+	}
+#endif
+};
+
+}
+
+
+inline Encoding detectEncoding(const std::string& str) {
+	size_t bomSize;
+	return _details::detectEncoding(str.data(), str.data() + str.size(), bomSize);
+}
+
+
+}
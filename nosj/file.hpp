@@ -0,0 +1,70 @@
+#ifndef FILE_HPP_
+#define FILE_HPP_
+
+
+#include "values.hpp"
+#include "lazy.hpp"
+#include "parse.hpp"
+#include <cstddef>
+#include <string>
+
+
+namespace nosj {
+
+
+class FileError : public Exception {
+public:
+	std::string path;
+	int error; // errno value
+	FileError(const std::string& path, int error);
+	virtual const char* what() const noexcept override { return message.c_str(); }
+private:
+	std::string message;
+};
+
+
+// A read-only memory mapping of a whole file. The file contents are parsed
+// straight from the mapping, without being copied.
+class MappedDocument {
+public:
+	explicit MappedDocument(const std::string& path);
+
+	MappedDocument(MappedDocument&&) noexcept;
+	MappedDocument(const MappedDocument&) = delete;
+
+	~MappedDocument() noexcept;
+
+	MappedDocument& operator=(MappedDocument&&) noexcept;
+	MappedDocument& operator=(const MappedDocument&) = delete;
+
+	const char* data() const noexcept { return data_; }
+	size_t      size() const noexcept { return size_; }
+
+	Value parse(const ParseOptions& = ParseOptions()) const;
+	Value parseParallel(unsigned int threadCount = 0, const ParseOptions& = ParseOptions()) const;
+	// The handle is valid as long as this document is alive
+	LazyValue lazyParse() const;
+
+private:
+	const char* data_;
+	size_t size_;
+};
+
+
+Value parseFile(const std::string& path, const ParseOptions& = ParseOptions());
+
+// Read a UTF-8 file in blocks instead of mapping it. A thread reads the next
+// blocks with pread() while the parser goes through the current one, so that
+// the reads overlap with the parsing and the memory used stays bounded. File
+// errors are thrown as FileError, even by tryReadFile().
+Value readFile(const std::string& path, const ParseOptions& = ParseOptions());
+ParseResult tryReadFile(const std::string& path, const ParseOptions& = ParseOptions());
+
+
+}
+
+
+#include "file.inl"
+
+
+#endif /* FILE_HPP_ */
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace nosj {
+
+
+inline FileError::FileError(const std::string& path, int error)
+	: path(path), error(error), message(path + ": " + std::strerror(error))
+{}
+
+
+namespace _details {
+
+struct FileDescriptor {
+	int fd;
+
+	FileDescriptor(const std::string& path) : fd(::open(path.c_str(), O_RDONLY)) {
+		if(fd < 0) {
+			throw FileError(path, errno);
+		}
+	}
+
+	~FileDescriptor() { ::close(fd); }
+};
+
+// Reads a file block after block into a ring of buffers, ahead of the consumer,
+// on a thread of its own. The consumer keeps the block that next() last gave
+// until it calls next() again; the thread fills the others meanwhile.
+class ReadAhead {
+public:
+	struct Block {
+		std::unique_ptr<char[]> data;
+		size_t size = 0;
+		std::uint64_t offset = 0; // In the file
+		bool last = false;
+		int error = 0; // errno value
+	};
+
+	ReadAhead(const std::string& path, size_t blockSize, unsigned int blockCount)
+		: path(path), file(path), blockSize(blockSize), blocks(blockCount < 2 ? 2 : blockCount) {
+		for(auto& block : blocks) {
+			block.data.reset(new char[blockSize]);
+		}
+		try {
+			thread = std::thread(&ReadAhead::readBlocks, this);
+		} catch(std::system_error&) {
+			// next() reads the blocks itself
+		}
+	}
+
+	~ReadAhead() {
+		if(thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			emptied.notify_one();
+			thread.join();
+		}
+	}
+
+	ReadAhead(const ReadAhead&) = delete;
+	ReadAhead& operator=(const ReadAhead&) = delete;
+
+	// The next block, which is empty at the end of the file
+	const Block& next() {
+		if(!thread.joinable()) {
+			Block& block = blocks[0];
+			readBlock(block, started ? block.offset + block.size : 0);
+			started = true;
+			return checked(block);
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if(started) {
+			consumed++;
+			emptied.notify_one();
+		}
+		started = true;
+		filled.wait(lock, [this]() { return produced > consumed; });
+		return checked(blocks[consumed % blocks.size()]);
+	}
+
+	// Reads the file again up to the position, only for errors
+	void locate(std::uint64_t position, std::uint64_t& line, std::uint64_t& column) const {
+		std::unique_ptr<char[]> buffer(new char[blockSize]);
+		std::uint64_t lineStart = 0;
+		line = 1;
+		for(std::uint64_t offset = 0; offset < position; ) {
+			size_t size = std::min<std::uint64_t>(blockSize, position - offset);
+			ssize_t count = ::pread(file.fd, buffer.get(), size, offset);
+			if(count <= 0) {
+				break;
+			}
+			const char* end = buffer.get() + count;
+			for(const char* p = buffer.get(); (p = static_cast<const char*>(std::memchr(p, '\n', end - p))); p++) {
+				line++;
+				lineStart = offset + (p - buffer.get()) + 1;
+			}
+			offset += count;
+		}
+		column = position - lineStart + 1;
+	}
+
+private:
+	const std::string path;
+	FileDescriptor file;
+	const size_t blockSize;
+	std::vector<Block> blocks;
+	bool started = false; // Whether next() gave a block already
+
+	std::mutex mutex;
+	std::condition_variable filled, emptied;
+	size_t produced = 0, consumed = 0; // Blocks, counted since the start
+	bool stopping = false;
+	std::thread thread;
+
+	void readBlocks() {
+		std::uint64_t offset = 0;
+		while(true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				emptied.wait(lock, [this]() { return stopping  ||  produced - consumed < blocks.size(); });
+				if(stopping) {
+					return;
+				}
+			}
+
+			// The consumer does not touch the blocks that are not produced yet
+			Block& block = blocks[produced % blocks.size()];
+			readBlock(block, offset);
+			offset += block.size;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				produced++;
+			}
+			filled.notify_one();
+			if(block.last) {
+				return;
+			}
+		}
+	}
+
+	void readBlock(Block& block, std::uint64_t offset) {
+		block.offset = offset;
+		block.size = 0;
+		block.error = 0;
+		while(block.size < blockSize) {
+			ssize_t count = ::pread(file.fd, block.data.get() + block.size, blockSize - block.size, offset + block.size);
+			if(count < 0  &&  errno == EINTR) {
+				continue;
+			} else if(count < 0) {
+				block.error = errno;
+				break;
+			} else if(count == 0) {
+				break;
+			}
+			block.size += count;
+		}
+		block.last = block.size < blockSize;
+	}
+
+	const Block& checked(const Block& block) const {
+		if(block.error != 0) {
+			throw FileError(path, block.error);
+		}
+		return block;
+	}
+};
+
+// Feeds the reader with the blocks of a ReadAhead
+struct ReadAheadInput {
+	using int_type = std::istream::int_type;
+	enum { eof = std::istream::traits_type::eof() };
+
+	ReadAhead file;
+	const char* begin = nullptr;
+	const char* current = nullptr;
+	const char* end = nullptr;
+	std::uint64_t offset = 0; // Of begin in the file
+	bool finished = false;
+
+	ReadAheadInput(const std::string& path, size_t blockSize, unsigned int blockCount)
+		: file(path, blockSize, blockCount) {}
+
+	int_type get() {
+		if(current == end  &&  !refill()) {
+			return eof;
+		}
+		return static_cast<unsigned char>(*current++);
+	}
+
+	int_type peek() {
+		if(current == end  &&  !refill()) {
+			return eof;
+		}
+		return static_cast<unsigned char>(*current);
+	}
+
+	std::uint64_t position() const {
+		return offset + (current - begin);
+	}
+
+	std::uint64_t previousPosition() const {
+		return position() - 1;
+	}
+
+	// A sequence that the end of the buffer cuts ends the run, and the reader
+	// takes it a byte at a time
+	void consumeStringRun(std::string* str, bool validateUTF8) {
+		while(true) {
+			const char* runEnd = validateUTF8 ? findValidUTF8RunEnd(current, end) : findStringRunEnd(current, end, false);
+			if(str) {
+				str->append(current, runEnd);
+			}
+			current = runEnd;
+			if(current != end  ||  !refill()) {
+				return;
+			}
+		}
+	}
+
+	void skippedLineFeed() {}
+
+	bool invalidSequence(std::uint64_t&) const {
+		return false;
+	}
+
+	void locate(std::uint64_t position, std::uint64_t& line, std::uint64_t& column) const {
+		file.locate(position, line, column);
+	}
+
+	bool refill() {
+		if(finished) {
+			return false;
+		}
+		const ReadAhead::Block& block = file.next();
+		begin = current = block.data.get();
+		end = begin + block.size;
+		offset = block.offset;
+		finished = block.last;
+		return current != end;
+	}
+};
+
+inline ParseResult tryReadFileAhead(const std::string& path, const ParseOptions& options, size_t blockSize,
+                                    unsigned int blockCount) {
+	BasicReader<ReadAheadInput> reader(path, blockSize, blockCount);
+	setUpReader(reader, options, nullptr);
+	return ReadDocument()(reader);
+}
+
+}
+
+
+inline MappedDocument::MappedDocument(const std::string& path) : data_(nullptr), size_(0) {
+	_details::FileDescriptor file(path);
+
+	struct stat status;
+	if(::fstat(file.fd, &status) != 0) {
+		throw FileError(path, errno);
+	}
+	if(status.st_size == 0) {
+		return; // Empty files cannot be mapped
+	}
+
+	size_t size = status.st_size;
+	void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+	if(address == MAP_FAILED) {
+		throw FileError(path, errno);
+	}
+
+	// Just hints; failures are harmless
+	::madvise(address, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	::madvise(address, size, MADV_HUGEPAGE);
+#endif
+
+	data_ = static_cast<const char*>(address);
+	size_ = size;
+}
+
+inline MappedDocument::MappedDocument(MappedDocument&& document) noexcept : data_(nullptr), size_(0) {
+	std::swap(data_, document.data_);
+	std::swap(size_, document.size_);
+}
+
+inline MappedDocument::~MappedDocument() noexcept {
+	if(data_) {
+		::munmap(const_cast<char*>(data_), size_);
+	}
+}
+
+inline MappedDocument& MappedDocument::operator=(MappedDocument&& document) noexcept {
+	std::swap(data_, document.data_);
+	std::swap(size_, document.size_);
+	return *this;
+}
+
+inline Value MappedDocument::parse(const ParseOptions& options) const {
+	return _details::parseBuffer(data_, data_ + size_, options);
+}
+
+inline Value MappedDocument::parseParallel(unsigned int threadCount, const ParseOptions& options) const {
+	return _details::parseBufferParallel(data_, data_ + size_, threadCount, options);
+}
+
+inline LazyValue MappedDocument::lazyParse() const {
+	return nosj::lazyParse(data_, data_ + size_);
+}
+
+
+inline Value parseFile(const std::string& path, const ParseOptions& options) {
+	return MappedDocument(path).parse(options);
+}
+
+inline Value readFile(const std::string& path, const ParseOptions& options) {
+	return tryReadFile(path, options).value();
+}
+
+inline ParseResult tryReadFile(const std::string& path, const ParseOptions& options) {
+	// Four blocks of 1 MiB: one being parsed and three being read ahead
+	return _details::tryReadFileAhead(path, options, 1 << 20, 4);
+}
+
+
+}
@@ -0,0 +1,96 @@
+#ifndef INDEX_HPP_
+#define INDEX_HPP_
+
+
+#include "values.hpp"
+#include "file.hpp"
+#include "parse.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace nosj {
+
+
+class InvalidIndex : public Exception {
+public:
+	std::string path;
+	InvalidIndex(const std::string& path) : path(path) {}
+	virtual const char* what() const noexcept override { return "Invalid or outdated index"; }
+};
+
+
+namespace _details {
+
+// What tells the versions of a file apart
+struct FileVersion {
+	std::uint64_t size;
+	std::uint64_t inode;
+	std::uint64_t modificationTime; // In nanoseconds since the epoch
+};
+
+}
+
+
+// The byte ranges of the elements of a large JSON file, found with one quick
+// scan, so that single elements can be read later without parsing the rest of
+// the file. The index can be saved next to the file and loaded again as long
+// as the file keeps its size, inode and modification time; an edit that keeps
+// all three within the resolution of the file system clock goes unnoticed.
+// The elements are only validated when read.
+class FileIndex {
+public:
+	enum class Layout {
+		Array, // The elements of a top level array
+		Lines  // One value per line (NDJSON); blank lines are skipped
+	};
+
+	struct Entry {
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	// The values of the keyMember of the elements that are objects are indexed
+	// too, unless keyMember is empty. An Array layout needs a UTF-8 document
+	// without byte order mark; if the document is not an array, the parse
+	// exception or InvalidConversion is thrown.
+	static FileIndex build(const std::string& path, Layout = Layout::Array, const String& keyMember = String());
+
+	void save(const std::string& indexPath) const;
+	static FileIndex load(const std::string& path, const std::string& indexPath);
+
+	size_t size() const { return entries.size(); }
+	const Entry& entry(size_t index) const { return entries.at(index); }
+	const String& keyMember() const { return keyMember_; }
+
+	// Finds the first element whose key member equals key. Keys are compared by
+	// their JSON text as stringify() writes it.
+	bool find(const Value& key, size_t& index) const;
+
+	// Read only one element of the file. The positions in the parse errors are
+	// relative to the element.
+	Value readElement(size_t index, const ParseOptions& = ParseOptions()) const;
+	// Throws std::out_of_range if no element has this key
+	Value readElementByKey(const Value& key, const ParseOptions& = ParseOptions()) const;
+
+private:
+	std::string path;
+	_details::FileVersion document = {};
+	std::vector<Entry> entries;
+	String keyMember_;
+	std::unordered_map<String, size_t> keys; // The JSON texts of the keys
+
+	void addEntry(const char* documentBegin, const char* begin, const char* end);
+};
+
+
+}
+
+
+#include "index.inl"
+
+
+#endif /* INDEX_HPP_ */
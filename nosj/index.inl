@@ -0,0 +1,247 @@
+#include "lazy.hpp"
+#include "stringify.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace nosj {
+
+
+namespace _details {
+
+// The index files start with this, followed by little-endian integers
+const char indexMagic[8] = {'N', 'O', 'S', 'J', 'I', 'D', 'X', '2'};
+const std::uint32_t noIndexKey = 0xFFFFFFFF;
+
+template <typename Integer>
+void writeIndexInteger(std::ostream& os, Integer n) {
+	char bytes[sizeof(Integer)];
+	for(size_t i = 0; i < sizeof(Integer); i++) {
+		bytes[i] = static_cast<char>(n >> (8 * i));
+	}
+	os.write(bytes, sizeof(Integer));
+}
+
+template <typename Integer>
+Integer readIndexInteger(std::istream& is) {
+	unsigned char bytes[sizeof(Integer)] = {};
+	is.read(reinterpret_cast<char*>(bytes), sizeof(Integer));
+	Integer n = 0;
+	for(size_t i = 0; i < sizeof(Integer); i++) {
+		n |= Integer(bytes[i]) << (8 * i);
+	}
+	return n;
+}
+
+inline void writeIndexString(std::ostream& os, const std::string& str) {
+	writeIndexInteger<std::uint32_t>(os, str.size());
+	os.write(str.data(), str.size());
+}
+
+inline bool readIndexString(std::istream& is, std::uint32_t size, std::string& str) {
+	str.resize(size);
+	return size == 0  ||  is.read(&str[0], size);
+}
+
+inline FileVersion fileVersion(const FileDescriptor& file, const std::string& path) {
+	struct stat status;
+	if(::fstat(file.fd, &status) != 0) {
+		throw FileError(path, errno);
+	}
+#ifdef __APPLE__
+	const struct timespec& modified = status.st_mtimespec;
+#else
+	const struct timespec& modified = status.st_mtim;
+#endif
+	return FileVersion{std::uint64_t(status.st_size), std::uint64_t(status.st_ino),
+	                   std::uint64_t(modified.tv_sec) * 1000000000 + modified.tv_nsec};
+}
+
+inline bool operator==(const FileVersion& a, const FileVersion& b) {
+	return a.size == b.size  &&  a.inode == b.inode  &&  a.modificationTime == b.modificationTime;
+}
+
+inline bool operator!=(const FileVersion& a, const FileVersion& b) {
+	return !(a == b);
+}
+
+}
+
+
+inline FileIndex FileIndex::build(const std::string& path, Layout layout, const String& keyMember) {
+	// The version before the scan, so that changes during the scan outdate it
+	FileIndex index;
+	index.path = path;
+	index.document = _details::fileVersion(_details::FileDescriptor(path), path);
+	index.keyMember_ = keyMember;
+
+	MappedDocument document(path);
+	const char* begin = document.data();
+	const char* end = begin + document.size();
+
+	if(layout == Layout::Lines) {
+		for(const char* line = begin; line != end; ) {
+			const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+			lineEnd = lineEnd ? lineEnd : end;
+			index.addEntry(begin, line, lineEnd);
+			line = lineEnd == end ? end : lineEnd + 1;
+		}
+		return index;
+	}
+
+	std::vector<_details::Span> elements;
+	if(!_details::splitTopLevelArray(begin, end, elements)) {
+		// The parse finds what is wrong, if anything, or else the document is
+		// not a UTF-8 array without byte order mark
+		_details::parseBuffer(begin, end);
+		throw InvalidConversion();
+	}
+	index.entries.reserve(elements.size());
+	for(auto& element : elements) {
+		index.addEntry(begin, element.begin, element.end);
+	}
+	return index;
+}
+
+inline void FileIndex::addEntry(const char* documentBegin, const char* begin, const char* end) {
+	begin = _details::skipStructuralWhitespaces(begin, end);
+	while(end != begin  &&  _details::isStructuralWhitespace(end[-1])) {
+		end--;
+	}
+	if(begin == end) {
+		return;
+	}
+
+	if(!keyMember_.empty()) {
+		LazyValue element = lazyParse(begin, end);
+		if(element.isObject()  &&  element.contains(keyMember_)) {
+			keys.emplace(stringify(element[keyMember_].value()), entries.size());
+		}
+	}
+	entries.push_back(Entry{std::uint64_t(begin - documentBegin), std::uint64_t(end - begin)});
+}
+
+inline void FileIndex::save(const std::string& indexPath) const {
+	std::vector<const String*> entryKeys(entries.size(), nullptr);
+	for(auto& key : keys) {
+		entryKeys[key.second] = &key.first;
+	}
+
+	std::ofstream os(indexPath, std::ios::binary);
+	os.write(_details::indexMagic, sizeof(_details::indexMagic));
+	_details::writeIndexInteger<std::uint64_t>(os, document.size);
+	_details::writeIndexInteger<std::uint64_t>(os, document.inode);
+	_details::writeIndexInteger<std::uint64_t>(os, document.modificationTime);
+	_details::writeIndexInteger<std::uint64_t>(os, entries.size());
+	_details::writeIndexString(os, keyMember_);
+	for(size_t i = 0; i < entries.size(); i++) {
+		_details::writeIndexInteger<std::uint64_t>(os, entries[i].offset);
+		_details::writeIndexInteger<std::uint64_t>(os, entries[i].size);
+		if(entryKeys[i]) {
+			_details::writeIndexString(os, *entryKeys[i]);
+		} else {
+			_details::writeIndexInteger<std::uint32_t>(os, _details::noIndexKey);
+		}
+	}
+
+	os.flush();
+	if(!os) {
+		throw FileError(indexPath, errno != 0 ? errno : EIO);
+	}
+}
+
+inline FileIndex FileIndex::load(const std::string& path, const std::string& indexPath) {
+	std::ifstream is(indexPath, std::ios::binary);
+	if(!is) {
+		throw FileError(indexPath, errno != 0 ? errno : EIO);
+	}
+
+	char magic[sizeof(_details::indexMagic)];
+	if(!is.read(magic, sizeof(magic))  ||  !std::equal(magic, magic + sizeof(magic), _details::indexMagic)) {
+		throw InvalidIndex(indexPath);
+	}
+
+	FileIndex index;
+	index.path = path;
+	index.document.size = _details::readIndexInteger<std::uint64_t>(is);
+	index.document.inode = _details::readIndexInteger<std::uint64_t>(is);
+	index.document.modificationTime = _details::readIndexInteger<std::uint64_t>(is);
+	std::uint64_t count = _details::readIndexInteger<std::uint64_t>(is);
+	if(!is  ||  !_details::readIndexString(is, _details::readIndexInteger<std::uint32_t>(is), index.keyMember_)) {
+		throw InvalidIndex(indexPath);
+	}
+
+	String key;
+	for(std::uint64_t i = 0; i < count; i++) {
+		Entry entry;
+		entry.offset = _details::readIndexInteger<std::uint64_t>(is);
+		entry.size = _details::readIndexInteger<std::uint64_t>(is);
+		std::uint32_t keySize = _details::readIndexInteger<std::uint32_t>(is);
+		if(keySize != _details::noIndexKey) {
+			if(!_details::readIndexString(is, keySize, key)) {
+				throw InvalidIndex(indexPath);
+			}
+			index.keys.emplace(key, index.entries.size());
+		}
+		// Not offset + size, which may wrap around
+		if(!is  ||  entry.size > index.document.size  ||  entry.offset > index.document.size - entry.size) {
+			throw InvalidIndex(indexPath);
+		}
+		index.entries.push_back(entry);
+	}
+
+	_details::FileDescriptor file(path);
+	if(_details::fileVersion(file, path) != index.document) {
+		throw InvalidIndex(indexPath);
+	}
+	return index;
+}
+
+inline bool FileIndex::find(const Value& key, size_t& index) const {
+	auto found = keys.find(stringify(key));
+	if(found == keys.end()) {
+		return false;
+	}
+	index = found->second;
+	return true;
+}
+
+inline Value FileIndex::readElement(size_t index, const ParseOptions& options) const {
+	const Entry& entry = entries.at(index);
+
+	_details::FileDescriptor file(path);
+	if(_details::fileVersion(file, path) != document) {
+		throw InvalidIndex(path);
+	}
+
+	std::string element(entry.size, '\0');
+	size_t read = 0;
+	while(read < entry.size) {
+		ssize_t count = ::pread(file.fd, &element[read], entry.size - read, entry.offset + read);
+		if(count < 0  &&  errno == EINTR) {
+			continue;
+		} else if(count < 0) {
+			throw FileError(path, errno);
+		} else if(count == 0) {
+			throw InvalidIndex(path);
+		}
+		read += count;
+	}
+	return parse(element, options);
+}
+
+inline Value FileIndex::readElementByKey(const Value& key, const ParseOptions& options) const {
+	size_t index;
+	if(!find(key, index)) {
+		throw std::out_of_range("nosj::FileIndex: no element with key " + stringify(key));
+	}
+	return readElement(index, options);
+}
+
+
+}
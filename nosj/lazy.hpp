@@ -0,0 +1,100 @@
+#ifndef LAZY_HPP_
+#define LAZY_HPP_
+
+
+#include "values.hpp"
+#include <cstddef>
+#include <iterator>
+#include <string>
+
+
+namespace nosj {
+
+
+// A handle to a JSON value in a buffer that is parsed only as far as each
+// access needs. Siblings that are not accessed are skipped by matching
+// brackets, without being validated or materialized. The buffer must outlive
+// the handle and all the handles obtained from it.
+class LazyValue {
+public:
+	class Iterator;
+
+	Value::Type type() const;
+
+	bool isNull()    const { return type() == Value::NullValue; }
+	bool isBoolean() const { return type() == Value::BooleanValue; }
+	bool isNumber()  const { return type() == Value::NumberValue; }
+	bool isString()  const { return type() == Value::StringValue; }
+	bool isArray()   const { return type() == Value::ArrayValue; }
+	bool isObject()  const { return type() == Value::ObjectValue; }
+
+	// Throw std::out_of_range if there is no such member or element
+	LazyValue operator[](const String& key) const;
+	LazyValue operator[](size_t index)      const;
+
+	bool contains(const String& key) const;
+	size_t size() const;
+
+	// Iterate over the elements of an array or the members of an object
+	Iterator begin() const;
+	Iterator end()   const;
+
+	// Fully parses this value
+	Value value() const;
+
+private:
+	const char* documentBegin;
+	const char* position;
+	const char* documentEnd;
+
+	LazyValue(const char* documentBegin, const char* position, const char* documentEnd)
+		: documentBegin(documentBegin), position(position), documentEnd(documentEnd) {}
+
+	friend LazyValue lazyParse(const std::string&);
+	friend LazyValue lazyParse(const char*, const char*);
+};
+
+
+class LazyValue::Iterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type        = LazyValue;
+	using difference_type   = std::ptrdiff_t;
+	using pointer           = void;
+	using reference         = LazyValue;
+
+	LazyValue operator*() const;
+
+	// The key of the current member, when iterating over an object
+	String key() const;
+	bool keyEquals(const String&) const;
+
+	Iterator& operator++();
+	Iterator  operator++(int);
+
+	bool operator==(const Iterator& other) const { return valuePosition == other.valuePosition; }
+	bool operator!=(const Iterator& other) const { return valuePosition != other.valuePosition; }
+
+private:
+	LazyValue container;
+	const char* keyPosition;
+	const char* valuePosition; // Null at the end
+
+	Iterator(const LazyValue& container, const char* elementPosition);
+	void locate(const char* elementPosition);
+
+	friend class LazyValue;
+};
+
+
+LazyValue lazyParse(const std::string&);
+LazyValue lazyParse(const char* begin, const char* end);
+
+
+}
+
+
+#include "lazy.inl"
+
+
+#endif /* LAZY_HPP_ */
@@ -0,0 +1,220 @@
+#include "parse.hpp"
+#include <cstring>
+#include <stdexcept>
+
+
+namespace nosj {
+
+
+namespace _details {
+
+__attribute__((noreturn))
+inline void throwUnexpectedAt(const char* documentBegin, const char* p, const char* end) {
+	if(p == end) {
+		throw IncompleteInput();
+	} else {
+		UnexpectedCharacter exception(*p, p - documentBegin);
+		locateInBuffer(documentBegin, p, exception.line, exception.column);
+		throw exception;
+	}
+}
+
+inline const char* skipLazyValue(const char* documentBegin, const char* p, const char* end) {
+	const char* after = skipStructuralValue(p, end);
+	if(after == nullptr) {
+		throw IncompleteInput();
+	} else if(after == p) {
+		throwUnexpectedAt(documentBegin, p, end);
+	}
+	return after;
+}
+
+}
+
+
+inline Value::Type LazyValue::type() const {
+	if(position != documentEnd) {
+		switch(*position) {
+		case 'n': return Value::NullValue;
+		case 'f':
+		case 't': return Value::BooleanValue;
+		case '"': return Value::StringValue;
+		case '[': return Value::ArrayValue;
+		case '{': return Value::ObjectValue;
+		default:
+			if((*position >= '0'  &&  *position <= '9')  ||  *position == '-') {
+				return Value::NumberValue;
+			}
+		}
+	}
+	_details::throwUnexpectedAt(documentBegin, position, documentEnd);
+}
+
+inline LazyValue LazyValue::operator[](const String& key) const {
+	if(!isObject()) {
+		throw InvalidConversion();
+	}
+	for(auto it = begin(); it != end(); ++it) {
+		if(it.keyEquals(key)) {
+			return *it;
+		}
+	}
+	throw std::out_of_range("nosj::LazyValue: no member \"" + key + '"');
+}
+
+inline LazyValue LazyValue::operator[](size_t index) const {
+	if(!isArray()) {
+		throw InvalidConversion();
+	}
+	for(auto it = begin(); it != end(); ++it) {
+		if(index-- == 0) {
+			return *it;
+		}
+	}
+	throw std::out_of_range("nosj::LazyValue: index out of range");
+}
+
+inline bool LazyValue::contains(const String& key) const {
+	if(!isObject()) {
+		throw InvalidConversion();
+	}
+	for(auto it = begin(); it != end(); ++it) {
+		if(it.keyEquals(key)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+inline size_t LazyValue::size() const {
+	size_t count = 0;
+	for(auto it = begin(); it != end(); ++it) {
+		count++;
+	}
+	return count;
+}
+
+inline LazyValue::Iterator LazyValue::begin() const {
+	Value::Type type = this->type();
+	if(type != Value::ArrayValue  &&  type != Value::ObjectValue) {
+		throw InvalidConversion();
+	}
+
+	const char* p = _details::skipStructuralWhitespaces(position + 1, documentEnd);
+	char closing = (type == Value::ArrayValue) ? ']' : '}';
+	if(p != documentEnd  &&  *p == closing) {
+		return end();
+	}
+	return Iterator(*this, p);
+}
+
+inline LazyValue::Iterator LazyValue::end() const {
+	return Iterator(*this, nullptr);
+}
+
+inline Value LazyValue::value() const {
+	_details::BufferReader reader(position, documentEnd, position - documentBegin);
+	Value value;
+	reader.check(reader.readValue(value));
+	return value;
+}
+
+
+inline LazyValue::Iterator::Iterator(const LazyValue& container, const char* elementPosition)
+	: container(container), keyPosition(nullptr), valuePosition(nullptr)
+{
+	if(elementPosition) {
+		locate(elementPosition);
+	}
+}
+
+inline void LazyValue::Iterator::locate(const char* p) {
+	const char* documentBegin = container.documentBegin;
+	const char* documentEnd = container.documentEnd;
+
+	if(*container.position == '[') {
+		valuePosition = p;
+		return;
+	}
+
+	if(p == documentEnd  ||  *p != '"') {
+		_details::throwUnexpectedAt(documentBegin, p, documentEnd);
+	}
+	keyPosition = p;
+
+	p = _details::skipStructuralString(p, documentEnd);
+	if(p == nullptr) {
+		throw IncompleteInput();
+	}
+	p = _details::skipStructuralWhitespaces(p, documentEnd);
+	if(p == documentEnd  ||  *p != ':') {
+		_details::throwUnexpectedAt(documentBegin, p, documentEnd);
+	}
+	valuePosition = _details::skipStructuralWhitespaces(p + 1, documentEnd);
+}
+
+inline LazyValue LazyValue::Iterator::operator*() const {
+	return LazyValue(container.documentBegin, valuePosition, container.documentEnd);
+}
+
+inline String LazyValue::Iterator::key() const {
+	if(keyPosition == nullptr) {
+		throw InvalidConversion();
+	}
+	_details::BufferReader reader(keyPosition, container.documentEnd, keyPosition - container.documentBegin);
+	String key;
+	reader.check(reader.readString(key));
+	return key;
+}
+
+inline bool LazyValue::Iterator::keyEquals(const String& key) const {
+	if(keyPosition == nullptr) {
+		throw InvalidConversion();
+	}
+
+	// Keys without escapes are compared in place
+	const char* keyBegin = keyPosition + 1;
+	const char* keyEnd = _details::skipStructuralString(keyPosition, container.documentEnd) - 1;
+	size_t length = keyEnd - keyBegin;
+	if(std::memchr(keyBegin, '\\', length) == nullptr) {
+		return length == key.size()  &&  std::memcmp(keyBegin, key.data(), length) == 0;
+	}
+	return this->key() == key;
+}
+
+inline LazyValue::Iterator& LazyValue::Iterator::operator++() {
+	const char* documentBegin = container.documentBegin;
+	const char* documentEnd = container.documentEnd;
+
+	const char* p = _details::skipLazyValue(documentBegin, valuePosition, documentEnd);
+	p = _details::skipStructuralWhitespaces(p, documentEnd);
+
+	char closing = (*container.position == '[') ? ']' : '}';
+	if(p != documentEnd  &&  *p == ',') {
+		locate(_details::skipStructuralWhitespaces(p + 1, documentEnd));
+	} else if(p != documentEnd  &&  *p == closing) {
+		keyPosition = nullptr;
+		valuePosition = nullptr;
+	} else {
+		_details::throwUnexpectedAt(documentBegin, p, documentEnd);
+	}
+	return *this;
+}
+
+inline LazyValue::Iterator LazyValue::Iterator::operator++(int) {
+	Iterator previous = *this;
+	++*this;
+	return previous;
+}
+
+
+inline LazyValue lazyParse(const char* begin, const char* end) {
+	return LazyValue(begin, _details::skipStructuralWhitespaces(begin, end), end);
+}
+
+inline LazyValue lazyParse(const std::string& str) {
+	return lazyParse(str.data(), str.data() + str.size());
+}
+
+
+}
@@ -0,0 +1,36 @@
+#ifndef LITERAL_HPP_
+#define LITERAL_HPP_
+
+
+#include "parse.hpp"
+#include <cstddef>
+
+
+// The value of a JSON text given as a string literal, as a const Value&. The
+// literal is parsed on the first use of each NOSJ_JSON() only, and the value
+// lives until the end of the program. A malformed literal is a compile error.
+#define NOSJ_JSON(text) \
+	([]() -> const ::nosj::Value& { \
+		static_assert(::nosj::_details::isValidLiteral(text, sizeof(text) - 1), "Invalid JSON literal: " text); \
+		static const ::nosj::Value value = ::nosj::parse(text); \
+		return value; \
+	}())
+
+
+namespace nosj {
+
+
+namespace _details {
+	// Whether the text is a JSON text that the parser accepts with the default
+	// options, barring numbers out of range and nesting beyond 64 levels
+	constexpr bool isValidLiteral(const char* text, size_t size);
+}
+
+
+}
+
+
+#include "literal.inl"
+
+
+#endif /* LITERAL_HPP_ */
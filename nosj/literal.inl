@@ -0,0 +1,197 @@
+namespace nosj {
+
+
+namespace _details {
+
+// The checker is a pushdown automaton that takes a character at a time, in
+// functions simple enough for constant expressions in C++11: a single return
+// statement each. The characters are split in halves down to single ones, so
+// that the recursion is only as deep as the logarithm of the size. The stack
+// of containers is a bit per level, set for objects, so literals nest up to 64
+// levels.
+
+enum class LiteralMode {
+	Value, FirstElement, FirstKey, Key, Colon, AfterValue,
+	String, Escape, HexDigits, TrailBackslash, TrailU,
+	Token,
+	Minus, Zero, IntegerDigits, Point, FractionDigits, Exponent, ExponentSign, ExponentDigits,
+	Invalid
+};
+
+struct LiteralState {
+	LiteralMode mode;
+	bool key;                   // Whether the string is a key
+	unsigned int depth;
+	unsigned long long objects; // The levels that are objects
+	const char* token;          // What is left of true, false or null
+	unsigned int hexLeft;       // Digits of a \u escape
+	unsigned int codePoint;     // Of the \u escape so far
+	bool trail;                 // Whether the \u escape must be a trail surrogate
+
+	constexpr LiteralState(LiteralMode mode, bool key, unsigned int depth, unsigned long long objects,
+	                       const char* token, unsigned int hexLeft, unsigned int codePoint, bool trail)
+		: mode(mode), key(key), depth(depth), objects(objects), token(token), hexLeft(hexLeft),
+		  codePoint(codePoint), trail(trail) {}
+
+	constexpr LiteralState to(LiteralMode newMode) const {
+		return LiteralState(newMode, key, depth, objects, token, hexLeft, codePoint, trail);
+	}
+
+	constexpr LiteralState invalid() const { return to(LiteralMode::Invalid); }
+
+	constexpr bool inObject() const { return depth > 0  &&  ((objects >> (depth - 1)) & 1) != 0; }
+
+	constexpr LiteralState open(bool object) const {
+		return depth == 64 ? invalid()
+		     : LiteralState(object ? LiteralMode::FirstKey : LiteralMode::FirstElement, false, depth + 1,
+		                    object ? objects | (1ULL << depth) : objects & ~(1ULL << depth), nullptr, 0, 0, false);
+	}
+
+	constexpr LiteralState close() const {
+		return LiteralState(LiteralMode::AfterValue, false, depth - 1, objects, nullptr, 0, 0, false);
+	}
+
+	constexpr LiteralState string(bool isKey) const {
+		return LiteralState(LiteralMode::String, isKey, depth, objects, nullptr, 0, 0, false);
+	}
+
+	constexpr LiteralState restOfToken(const char* rest) const {
+		return LiteralState(LiteralMode::Token, false, depth, objects, rest, 0, 0, false);
+	}
+
+	constexpr LiteralState hex(unsigned int left, unsigned int value, bool isTrail) const {
+		return LiteralState(LiteralMode::HexDigits, key, depth, objects, nullptr, left, value, isTrail);
+	}
+};
+
+constexpr bool isLiteralWhitespace(char ch) {
+	return ch == ' '  ||  ch == '\t'  ||  ch == '\n'  ||  ch == '\r';
+}
+
+constexpr bool isLiteralDigit(char ch) {
+	return ch >= '0'  &&  ch <= '9';
+}
+
+constexpr int literalHexValue(char ch) {
+	return isLiteralDigit(ch)            ? ch - '0'
+	     : (ch >= 'a'  &&  ch <= 'f')    ? ch - 'a' + 10
+	     : (ch >= 'A'  &&  ch <= 'F')    ? ch - 'A' + 10
+	     : -1;
+}
+
+constexpr LiteralState beginLiteralValue(const LiteralState& s, char ch) {
+	return ch == '{'                ? s.open(true)
+	     : ch == '['                ? s.open(false)
+	     : ch == '"'                ? s.string(false)
+	     : ch == 't'                ? s.restOfToken("rue")
+	     : ch == 'f'                ? s.restOfToken("alse")
+	     : ch == 'n'                ? s.restOfToken("ull")
+	     : ch == '-'                ? s.to(LiteralMode::Minus)
+	     : ch == '0'                ? s.to(LiteralMode::Zero)
+	     : isLiteralDigit(ch)       ? s.to(LiteralMode::IntegerDigits)
+	     : isLiteralWhitespace(ch)  ? s
+	     : s.invalid();
+}
+
+constexpr LiteralState stepAfterLiteralValue(const LiteralState& s, char ch) {
+	return isLiteralWhitespace(ch)                   ? s
+	     : (ch == ','  &&  s.depth > 0)              ? s.to(s.inObject() ? LiteralMode::Key : LiteralMode::Value)
+	     : (ch == ']'  &&  s.depth > 0  &&  !s.inObject()) ? s.close()
+	     : (ch == '}'  &&  s.inObject())             ? s.close()
+	     : s.invalid();
+}
+
+// A number ends at the first character that cannot continue it
+constexpr LiteralState endLiteralNumber(const LiteralState& s, char ch) {
+	return stepAfterLiteralValue(s.to(LiteralMode::AfterValue), ch);
+}
+
+constexpr LiteralState endLiteralHexDigits(const LiteralState& s, unsigned int codePoint) {
+	return s.trail  ? ((codePoint >= 0xDC00  &&  codePoint <= 0xDFFF) ? s.to(LiteralMode::String) : s.invalid())
+	     : (codePoint >= 0xD800  &&  codePoint <= 0xDBFF) ? s.to(LiteralMode::TrailBackslash)
+	     : s.to(LiteralMode::String);
+}
+
+constexpr LiteralState stepLiteralHexDigit(const LiteralState& s, int value) {
+	return value < 0        ? s.invalid()
+	     : s.hexLeft > 1    ? s.hex(s.hexLeft - 1, s.codePoint * 16 + value, s.trail)
+	     : endLiteralHexDigits(s, s.codePoint * 16 + value);
+}
+
+constexpr LiteralState stepLiteralString(const LiteralState& s, char ch) {
+	return ch == '"'                        ? s.to(s.key ? LiteralMode::Colon : LiteralMode::AfterValue)
+	     : ch == '\\'                       ? s.to(LiteralMode::Escape)
+	     : static_cast<unsigned char>(ch) < 0x20 ? s.invalid()
+	     : s;
+}
+
+constexpr LiteralState stepLiteralEscape(const LiteralState& s, char ch) {
+	return (ch == '"'  ||  ch == '\\'  ||  ch == '/'  ||  ch == 'b'  ||  ch == 'f'  ||  ch == 'n'  ||  ch == 'r'
+	        ||  ch == 't')  ? s.to(LiteralMode::String)
+	     : ch == 'u'        ? s.hex(4, 0, false)
+	     : s.invalid();
+}
+
+constexpr LiteralState stepLiteralToken(const LiteralState& s, char ch) {
+	return ch != *s.token        ? s.invalid()
+	     : s.token[1] == '\0'    ? s.to(LiteralMode::AfterValue)
+	     : s.restOfToken(s.token + 1);
+}
+
+constexpr LiteralState stepLiteralNumber(const LiteralState& s, char ch) {
+	return s.mode == LiteralMode::Minus
+	         ? (ch == '0' ? s.to(LiteralMode::Zero) : isLiteralDigit(ch) ? s.to(LiteralMode::IntegerDigits) : s.invalid())
+	     : s.mode == LiteralMode::Point
+	         ? (isLiteralDigit(ch) ? s.to(LiteralMode::FractionDigits) : s.invalid())
+	     : s.mode == LiteralMode::Exponent
+	         ? ((ch == '+'  ||  ch == '-') ? s.to(LiteralMode::ExponentSign)
+	            : isLiteralDigit(ch) ? s.to(LiteralMode::ExponentDigits) : s.invalid())
+	     : s.mode == LiteralMode::ExponentSign
+	         ? (isLiteralDigit(ch) ? s.to(LiteralMode::ExponentDigits) : s.invalid())
+	     // Zero, IntegerDigits, FractionDigits and ExponentDigits may end here
+	     : (isLiteralDigit(ch)  &&  s.mode != LiteralMode::Zero) ? s
+	     : (ch == '.'  &&  (s.mode == LiteralMode::Zero  ||  s.mode == LiteralMode::IntegerDigits))
+	         ? s.to(LiteralMode::Point)
+	     : ((ch == 'e'  ||  ch == 'E')  &&  s.mode != LiteralMode::ExponentDigits) ? s.to(LiteralMode::Exponent)
+	     : endLiteralNumber(s, ch);
+}
+
+constexpr LiteralState stepLiteral(const LiteralState& s, char ch) {
+	return s.mode == LiteralMode::Value           ? beginLiteralValue(s, ch)
+	     : s.mode == LiteralMode::FirstElement    ? (ch == ']' ? s.close() : beginLiteralValue(s, ch))
+	     : s.mode == LiteralMode::FirstKey        ? (ch == '}' ? s.close() : ch == '"' ? s.string(true)
+	                                                 : isLiteralWhitespace(ch) ? s : s.invalid())
+	     : s.mode == LiteralMode::Key             ? (ch == '"' ? s.string(true) : isLiteralWhitespace(ch) ? s : s.invalid())
+	     : s.mode == LiteralMode::Colon           ? (ch == ':' ? s.to(LiteralMode::Value)
+	                                                 : isLiteralWhitespace(ch) ? s : s.invalid())
+	     : s.mode == LiteralMode::AfterValue      ? stepAfterLiteralValue(s, ch)
+	     : s.mode == LiteralMode::String          ? stepLiteralString(s, ch)
+	     : s.mode == LiteralMode::Escape          ? stepLiteralEscape(s, ch)
+	     : s.mode == LiteralMode::HexDigits       ? stepLiteralHexDigit(s, literalHexValue(ch))
+	     : s.mode == LiteralMode::TrailBackslash  ? (ch == '\\' ? s.to(LiteralMode::TrailU) : s.invalid())
+	     : s.mode == LiteralMode::TrailU          ? (ch == 'u' ? s.hex(4, 0, true) : s.invalid())
+	     : s.mode == LiteralMode::Token           ? stepLiteralToken(s, ch)
+	     : s.mode == LiteralMode::Invalid         ? s
+	     : stepLiteralNumber(s, ch);
+}
+
+constexpr LiteralState checkLiteralChars(const LiteralState& s, const char* p, size_t size) {
+	return (s.mode == LiteralMode::Invalid  ||  size == 0) ? s
+	     : size == 1 ? stepLiteral(s, *p)
+	     : checkLiteralChars(checkLiteralChars(s, p, size / 2), p + size / 2, size - size / 2);
+}
+
+// A whitespace after the text ends a number at the top level
+constexpr bool isCompleteLiteral(const LiteralState& s) {
+	return s.mode == LiteralMode::AfterValue  &&  s.depth == 0;
+}
+
+constexpr bool isValidLiteral(const char* text, size_t size) {
+	return isCompleteLiteral(stepLiteral(checkLiteralChars(
+		LiteralState(LiteralMode::Value, false, 0, 0, nullptr, 0, 0, false), text, size), ' '));
+}
+
+}
+
+
+}
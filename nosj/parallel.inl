@@ -0,0 +1,178 @@
+#ifndef PARALLEL_INL_
+#define PARALLEL_INL_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+
+namespace nosj {
+
+namespace _details {
+
+inline unsigned int defaultThreadCount() {
+	unsigned int count = std::thread::hardware_concurrency();
+	return count > 0 ? count : 1;
+}
+
+// Calls task(i) for the indices that the threads that run it claim. Threads
+// claim the next unprocessed index as soon as they finish the previous one, so
+// uneven tasks are balanced dynamically. The first exception thrown by a task
+// stops the claiming of new indices, and rethrow() throws it once all the
+// threads have finished.
+template <typename Task>
+class ParallelLoop {
+public:
+	ParallelLoop(size_t count, Task& task) : count(count), task(task), next(0), failed(false) {}
+
+	void operator()() {
+		while(!failed) {
+			size_t i = next++;
+			if(i >= count) {
+				break;
+			}
+			try {
+				task(i);
+			} catch(...) {
+				std::lock_guard<std::mutex> lock(exceptionMutex);
+				if(!failed) {
+					exception = std::current_exception();
+					failed = true;
+				}
+			}
+		}
+	}
+
+	void rethrow() {
+		if(exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+
+private:
+	const size_t count;
+	Task& task;
+	std::atomic<size_t> next;
+	std::atomic<bool> failed;
+	std::exception_ptr exception;
+	std::mutex exceptionMutex;
+};
+
+// Calls task(i) for every i in [0, count) using up to threadCount threads,
+// the calling thread included, which it starts for this call only
+template <typename Task>
+void parallelFor(size_t count, unsigned int threadCount, Task task) {
+	ParallelLoop<Task> loop(count, task);
+
+	size_t extraThreads = std::min<size_t>(threadCount, count);
+	extraThreads = extraThreads > 0 ? extraThreads - 1 : 0;
+
+	std::vector<std::thread> threads;
+	threads.reserve(extraThreads);
+	for(size_t i = 0; i < extraThreads; i++) {
+		try {
+			threads.emplace_back(std::ref(loop));
+		} catch(std::system_error&) {
+			break; // Go on with the threads already started
+		}
+	}
+	loop();
+	for(auto& thread : threads) {
+		thread.join();
+	}
+	loop.rethrow();
+}
+
+// Threads that wait for the loops of parallelFor() from one call to the next,
+// so that a call costs no thread creation. The calling thread takes part too.
+// One call at a time: a pool must not be used by several threads at once.
+class WorkerPool {
+public:
+	explicit WorkerPool(unsigned int threadCount) {
+		for(unsigned int i = 1; i < threadCount; i++) {
+			try {
+				workers.emplace_back(&WorkerPool::work, this);
+			} catch(std::system_error&) {
+				break; // Go on with the threads already started
+			}
+		}
+	}
+
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	unsigned int threadCount() const { return workers.size() + 1; }
+
+	template <typename Task>
+	void parallelFor(size_t count, Task task) {
+		ParallelLoop<Task> loop(count, task);
+		if(!workers.empty()  &&  count > 1) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				job = std::ref(loop);
+				generation++;
+				busyCount = workers.size();
+			}
+			wake.notify_all();
+			loop();
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this]() { return busyCount == 0; });
+			job = nullptr;
+		} else {
+			loop();
+		}
+		loop.rethrow();
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::function<void()> job;
+	size_t generation = 0; // Of the job, which each worker runs once
+	size_t busyCount = 0;
+	bool stopping = false;
+
+	void work() {
+		size_t lastGeneration = 0;
+		while(true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return stopping  ||  generation != lastGeneration; });
+				if(stopping) {
+					return;
+				}
+				lastGeneration = generation;
+			}
+			job();
+			std::lock_guard<std::mutex> lock(mutex);
+			if(--busyCount == 0) {
+				done.notify_one();
+			}
+		}
+	}
+};
+}
+
+}
+
+
+#endif /* PARALLEL_INL_ */
@@ -2,15 +2,28 @@
 #define PARSE_HPP_
 
 
+#include "encoding.hpp"
 #include "values.hpp"
+#include <cstdint>
+#include <initializer_list>
 #include <istream>
+#include <memory>
 #include <sstream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 
 namespace nosj {
 
 
-class ParseException : public Exception {};
+class ParseException : public Exception {
+public:
+	// Where the error is, both counted from 1, or 0 if unknown. Columns count
+	// the same units as positions: bytes, or code units of wide strings.
+	std::uint64_t line = 0;
+	std::uint64_t column = 0;
+};
 
 class IncompleteInput : public ParseException {
 	virtual const char* what() const noexcept override { return "Incomplete input"; }
@@ -19,26 +32,244 @@ class IncompleteInput : public ParseException {
 class UnexpectedCharacter : public ParseException {
 public:
 	char character;
-	unsigned int position;
-	UnexpectedCharacter(char character, unsigned int position);
-	virtual const char* what() const noexcept override { return message.c_str(); }
+	std::uint64_t position;
+	UnexpectedCharacter(char character, std::uint64_t position) : character(character), position(position) {}
+	virtual const char* what() const noexcept override;
 private:
-	std::string message;
+	mutable std::string message; // Formatted on the first call to what()
 };
 
 class ExpectedTrailCodePoint : public ParseException {
 public:
-	unsigned int position;
-	ExpectedTrailCodePoint(unsigned int position) : position(position) {}
+	std::uint64_t position;
+	ExpectedTrailCodePoint(std::uint64_t position) : position(position) {}
 };
 
 class InvalidCodePoint : ParseException {};
 
+class InvalidUTF8 : public ParseException {
+public:
+	std::uint64_t position; // Of the first byte of the invalid sequence
+	InvalidUTF8(std::uint64_t position) : position(position) {}
+	virtual const char* what() const noexcept override { return "Invalid UTF-8 sequence"; }
+};
+
+// A UTF-16 or UTF-32 input with a lone surrogate, a code point out of range or
+// a truncated code unit
+class InvalidEncoding : public ParseException {
+public:
+	std::uint64_t position; // Of the first code unit of the invalid sequence
+	InvalidEncoding(std::uint64_t position) : position(position) {}
+	virtual const char* what() const noexcept override { return "Invalid code unit sequence"; }
+};
+
+class NumberOutOfRange : public ParseException {
+public:
+	std::uint64_t position;
+	NumberOutOfRange(std::uint64_t position) : position(position) {}
+	virtual const char* what() const noexcept override { return "Number out of range"; }
+};
+
+
+// Describes why a non-throwing parse failed
+class ParseError {
+public:
+	enum class Kind {
+		None, IncompleteInput, UnexpectedCharacter, ExpectedTrailCodePoint, InvalidUTF8, InvalidEncoding,
+		NumberOutOfRange
+	};
+
+	Kind kind;
+	std::uint64_t position;
+	char character; // Only for unexpected characters
+
+	// Found only once the error is reported (see ParseException)
+	std::uint64_t line = 0;
+	std::uint64_t column = 0;
+
+	ParseError() noexcept : ParseError(Kind::None, 0) {}
+	ParseError(Kind kind, std::uint64_t position, char character = '\0') noexcept
+		: kind(kind), position(position), character(character) {}
+
+	explicit operator bool() const noexcept { return kind != Kind::None; }
+
+	// Formatted only on request
+	std::string message() const;
+
+	// Throws the exception that the throwing functions would throw
+	void raise() const;
+};
+
+class InvalidProjectionPath : public Exception {
+public:
+	std::string path;
+	InvalidProjectionPath(const std::string& path) : path(path) {}
+	virtual const char* what() const noexcept override { return "Invalid projection path"; }
+};
+
+
+struct ParseOptions {
+	// Reject strings that are not valid UTF-8
+	bool validateUTF8;
+
+	ParseOptions() : validateUTF8(false) {}
+};
+
+
+class ParseResult;
+
+namespace _details {
+	struct ProjectionNode;
+	class WorkerPool;
+
+	// Buffers that the reader reuses from one value to the next
+	struct ReaderScratch {
+		std::string number;
+		String memberKey;
+		std::vector<const Value*> visitedMembers;
+		std::unordered_set<const Value*> visitedMemberSet; // The same members
+	};
+}
+
+// A compiled set of JSON Pointer-like paths, like "/user/id" or
+// "/items/*/price", where "*" matches any member or element. Parsing with a
+// projection builds only the selected values and the containers on their
+// paths; everything else is validated and skipped. Array elements that are not
+// on any path become null, so that the other elements keep their indexes.
+class Projection {
+public:
+	Projection(std::initializer_list<std::string> paths);
+	Projection& add(const std::string& path);
+
+private:
+	std::vector<std::vector<String>> paths;
+	std::shared_ptr<const _details::ProjectionNode> root;
+
+	static std::vector<String> splitPath(const std::string&);
+	void compile();
+
+	friend ParseResult tryParse(const std::string&, const Projection&, const ParseOptions&);
+	friend ParseResult tryReadFrom(std::istream&, const Projection&, const ParseOptions&);
+};
+
+
+// The result of a non-throwing parse: either a value or an error
+class ParseResult {
+public:
+	ParseResult(Value&& value) noexcept : value_(std::move(value)) {}
+	ParseResult(const ParseError& error) noexcept : error_(error) {}
+
+	bool ok() const noexcept { return !error_; }
+	explicit operator bool() const noexcept { return ok(); }
+
+	// Throw the parse exception if the parse failed
+	const Value& value() const &;
+	Value&       value() &;
+	Value&&      value() &&;
+
+	const ParseError& error() const noexcept { return error_; }
+
+private:
+	Value value_;
+	ParseError error_;
+};
+
+
+// Parses document after document with the same options, keeping its scratch
+// buffers from one call to the next, so that the calls allocate hardly more
+// than the values they build. A parser is meant to be kept by a thread; it must
+// not be used by several threads at once.
+class Parser {
+public:
+	ParseOptions options;
+
+	Parser() {}
+	explicit Parser(const ParseOptions& options) : options(options) {}
+
+	Value parse(const std::string&);
+	Value parse(const char* data, size_t size);
+	Value readFrom(std::istream&);
+	void parseInto(Value& target, const std::string&);
+	void parseInto(Value& target, std::istream&);
+
+	ParseResult tryParse(const std::string&);
+	ParseResult tryParse(const char* data, size_t size);
+	ParseResult tryReadFrom(std::istream&);
+
+private:
+	_details::ReaderScratch scratch;
+};
+
 
 std::istream& operator>>(std::istream&, Value&);
 
-Value parse(const std::string&);
-Value readFrom(std::istream&);
+// The encoding of a std::string is detected (see detectEncoding()); a
+// std::u16string is UTF-16 and a std::u32string is UTF-32. The positions in the
+// errors count the elements of the string: bytes, or UTF-16 or UTF-32 code
+// units.
+Value parse(const std::string&, const ParseOptions& = ParseOptions());
+Value parse(const std::u16string&, const ParseOptions& = ParseOptions());
+Value parse(const std::u32string&, const ParseOptions& = ParseOptions());
+Value parse(const std::string&, const Projection&, const ParseOptions& = ParseOptions());
+// Parses the elements of a top level array on several threads (all the
+// hardware threads if threadCount is 0). Other values are parsed serially.
+Value parseParallel(const std::string&, unsigned int threadCount = 0, const ParseOptions& = ParseOptions());
+Value readFrom(std::istream&, const ParseOptions& = ParseOptions());
+Value readFrom(std::istream&, const Projection&, const ParseOptions& = ParseOptions());
+
+// Parse into an existing value, reusing what it can of it: the capacity of its
+// strings, the elements of its arrays and the members of its objects with the
+// same keys. Documents of a recurring shape are parsed this way with hardly any
+// allocation. After an error, the target holds whatever was parsed until then.
+void parseInto(Value& target, const std::string&, const ParseOptions& = ParseOptions());
+void parseInto(Value& target, std::istream&, const ParseOptions& = ParseOptions());
+
+// A document of a batch, which refers to the text without copying it
+struct BatchDocument {
+	const char* data;
+	size_t size;
+
+	BatchDocument(const char* data, size_t size) : data(data), size(size) {}
+	BatchDocument(const std::string& str) : data(str.data()), size(str.size()) {}
+};
+
+// Parses the documents of batches on several threads (all the hardware threads
+// if threadCount is 0), and gives a result per document, in the same order. It
+// keeps its threads and their parsers from one batch to the next, so that a
+// batch costs no thread creation. One batch at a time: a batch parser must not
+// be used by several threads at once.
+class BatchParser {
+public:
+	ParseOptions options;
+
+	explicit BatchParser(unsigned int threadCount = 0, const ParseOptions& = ParseOptions());
+	~BatchParser();
+
+	unsigned int threadCount() const;
+
+	std::vector<ParseResult> parse(const std::vector<BatchDocument>&);
+	std::vector<ParseResult> parse(const std::vector<std::string>&);
+
+private:
+	std::unique_ptr<_details::WorkerPool> pool;
+	std::vector<Parser> parsers; // One per chunk of a batch
+};
+
+// With a batch parser shared by the calls with the default thread count, which
+// keeps its threads from one batch to the next. Other counts, and calls while
+// another thread has a batch on it, start threads for the call only; callers
+// that want threads of their own kept use a BatchParser.
+std::vector<ParseResult> parseBatch(const std::vector<BatchDocument>&, unsigned int threadCount = 0,
+                                    const ParseOptions& = ParseOptions());
+std::vector<ParseResult> parseBatch(const std::vector<std::string>&, unsigned int threadCount = 0,
+                                    const ParseOptions& = ParseOptions());
+
+ParseResult tryParse(const std::string&, const ParseOptions& = ParseOptions());
+ParseResult tryParse(const std::u16string&, const ParseOptions& = ParseOptions());
+ParseResult tryParse(const std::u32string&, const ParseOptions& = ParseOptions());
+ParseResult tryParse(const std::string&, const Projection&, const ParseOptions& = ParseOptions());
+ParseResult tryReadFrom(std::istream&, const ParseOptions& = ParseOptions());
+ParseResult tryReadFrom(std::istream&, const Projection&, const ParseOptions& = ParseOptions());
 
 
 }
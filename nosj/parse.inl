@@ -1,256 +1,760 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 #include <utility>
+#include <vector>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+#include "parallel.inl"
+
 
-#ifdef __CYGWIN__
+namespace nosj {
 
-#include <iomanip>
 
 namespace _details {
 
-template <typename T>
-T stoX(const std::string& str, size_t* idx, int base) {
-	std::istringstream is(str);
-	T result;
-	if(base >= 0) {
-		is >> std::setbase(base);
-	}
-	is >> result;
-	if(idx) {
-		if(is.eof()) {
-			*idx = str.length();
-		} else {
-			*idx = is.tellg();
+inline std::string decimalString(unsigned long long n) {
+	char digits[20];
+	char* p = digits + sizeof(digits);
+	do {
+		*--p = '0' + n % 10;
+		n /= 10;
+	} while(n > 0);
+	return std::string(p, digits + sizeof(digits));
+}
+
+}
+
+
+inline const char* UnexpectedCharacter::what() const noexcept {
+	if(message.empty()) {
+		try {
+			ParseError error(ParseError::Kind::UnexpectedCharacter, position, character);
+			error.line = line;
+			error.column = column;
+			message = error.message();
+		} catch(...) {
+			return "Unexpected character";
 		}
 	}
-	return result;
+	return message.c_str();
 }
 
-}
 
-namespace std {
+inline std::string ParseError::message() const {
+	std::string message;
+	switch(kind) {
+	case Kind::None:
+		return "No error";
+	case Kind::IncompleteInput:
+		return "Incomplete input";
+	case Kind::UnexpectedCharacter: {
+		static const char hexDigits[] = "0123456789ABCDEF";
+		unsigned char ch = character;
+		message = "Unexpected character '\\u00";
+		message += hexDigits[ch >> 4];
+		message += hexDigits[ch & 0xF];
+		message += "'";
+		break;
+	}
+	case Kind::ExpectedTrailCodePoint:
+		message = "Expected trail code point";
+		break;
+	case Kind::InvalidUTF8:
+		message = "Invalid UTF-8 sequence";
+		break;
+	case Kind::InvalidEncoding:
+		message = "Invalid code unit sequence";
+		break;
+	case Kind::NumberOutOfRange:
+		message = "Number out of range";
+		break;
+	default:
+		return "Unknown error";
+	}
 
-inline long long stoll(const std::string& str, size_t* idx = 0, int base = 10) {
-	return _details::stoX<long long>(str, idx, base);
+	message += " at position " + _details::decimalString(position);
+	if(line > 0) {
+		message += " (line " + _details::decimalString(line) + ", column " + _details::decimalString(column) + ")";
+	}
+	return message;
 }
 
-inline long double stold(const std::string& str, size_t* idx = 0) {
-	return _details::stoX<long double>(str, idx, -1);
+namespace _details {
+
+template <typename Exception>
+__attribute__((noreturn))
+void throwLocated(Exception exception, const ParseError& error) {
+	exception.line = error.line;
+	exception.column = error.column;
+	throw exception;
 }
 
 }
 
-#endif
+inline void ParseError::raise() const {
+	switch(kind) {
+	case Kind::None:                   return;
+	case Kind::IncompleteInput:        _details::throwLocated(IncompleteInput(), *this);
+	case Kind::UnexpectedCharacter:    _details::throwLocated(UnexpectedCharacter(character, position), *this);
+	case Kind::ExpectedTrailCodePoint: _details::throwLocated(ExpectedTrailCodePoint(position), *this);
+	case Kind::InvalidUTF8:            _details::throwLocated(InvalidUTF8(position), *this);
+	case Kind::InvalidEncoding:        _details::throwLocated(InvalidEncoding(position), *this);
+	case Kind::NumberOutOfRange:       _details::throwLocated(NumberOutOfRange(position), *this);
+	}
+}
 
 
-namespace nosj {
+inline const Value& ParseResult::value() const & {
+	error_.raise();
+	return value_;
+}
 
+inline Value& ParseResult::value() & {
+	error_.raise();
+	return value_;
+}
 
-inline UnexpectedCharacter::UnexpectedCharacter(char character, unsigned int position)
-	: character(character), position(position)
-{
-	std::ostringstream ostr;
-	ostr << "Unexpected character '\\u";
-	ostr.fill('0');
-	ostr.width(4);
-	ostr << std::hex << std::uppercase << int(character) << "' at position " << position;
-	message = ostr.str();
+inline Value&& ParseResult::value() && {
+	error_.raise();
+	return std::move(value_);
 }
 
 
 namespace _details {
 
-struct Reader {
+// Finds the line and the column of p, both counted from 1, by counting the line
+// feeds from the beginning of the document. It is only done for errors, so that
+// the reading does not need to keep track of the lines.
+inline void locateInBuffer(const char* begin, const char* p, std::uint64_t& line, std::uint64_t& column) {
+	const char* lineStart = begin;
+	line = 1;
+	while(const char* lineFeed = static_cast<const char*>(std::memchr(lineStart, '\n', p - lineStart))) {
+		line++;
+		lineStart = lineFeed + 1;
+	}
+	column = p - lineStart + 1;
+}
+
+struct StreamInput {
 	using istream = std::istream;
-	enum { eof = istream::traits_type::eof() };
+	using int_type = istream::int_type;
 
 	istream& is;
-	unsigned int positionNextChar = 0;
+	std::uint64_t positionNextChar = 0;
+
+	// Streams cannot be scanned again, so their lines are counted as the reader
+	// skips the line feeds between tokens, the only ones of valid JSON
+	std::uint64_t line = 1;
+	std::uint64_t lineStart = 0;
+	std::uint64_t previousLineStart = 0;
+
+	StreamInput(istream& is) : is(is) {}
+
+	int_type get() {
+		positionNextChar++;
+		return is.get();
+	}
+
+	void skippedLineFeed() {
+		line++;
+		previousLineStart = lineStart;
+		lineStart = positionNextChar;
+	}
+
+	int_type peek() {
+		return is.peek();
+	}
+
+	std::uint64_t position() const {
+		return positionNextChar;
+	}
+
+	std::uint64_t previousPosition() const {
+		return positionNextChar - 1;
+	}
+
+	// Streams are read one character at a time
+	void consumeStringRun(std::string*, bool) {}
+
+	bool invalidSequence(std::uint64_t&) const {
+		return false;
+	}
+
+	// Errors are on the current line, or on the line feed just extracted
+	void locate(std::uint64_t position, std::uint64_t& line, std::uint64_t& column) const {
+		if(position >= lineStart) {
+			line = this->line;
+			column = position - lineStart + 1;
+		} else {
+			line = this->line - 1;
+			column = position - previousLineStart + 1;
+		}
+	}
+};
+
+struct BufferInput {
+	using int_type = std::istream::int_type;
+	enum { eof = std::istream::traits_type::eof() };
+
+	const char* const begin;
+	const char* current;
+	const char* const end;
+	const std::uint64_t offset;
+
+	// The offset is added to the reported positions, so that a slice of a
+	// larger buffer reports positions relative to the whole buffer.
+	BufferInput(const char* begin, const char* end, std::uint64_t offset = 0)
+		: begin(begin), current(begin), end(end), offset(offset) {}
+
+	int_type get() {
+		if(current == end) {
+			return eof;
+		}
+		return static_cast<unsigned char>(*current++);
+	}
+
+	int_type peek() {
+		if(current == end) {
+			return eof;
+		}
+		return static_cast<unsigned char>(*current);
+	}
+
+	std::uint64_t position() const {
+		return offset + (current - begin);
+	}
+
+	std::uint64_t previousPosition() const {
+		return position() - 1;
+	}
+
+	void consumeStringRun(std::string* str, bool validateUTF8) {
+		const char* runEnd = validateUTF8 ? findValidUTF8RunEnd(current, end) : findStringRunEnd(current, end, false);
+		if(str) {
+			str->append(current, runEnd);
+		}
+		current = runEnd;
+	}
+
+	void skippedLineFeed() {}
+
+	bool invalidSequence(std::uint64_t&) const {
+		return false;
+	}
+
+	// The buffer is always a part of the document that starts offset bytes
+	// before it
+	void locate(std::uint64_t position, std::uint64_t& line, std::uint64_t& column) const {
+		const char* documentBegin = begin - offset;
+		locateInBuffer(documentBegin, documentBegin + position, line, column);
+	}
+};
+
+// Feeds the reader with the UTF-8 form of a UTF-16 or UTF-32 buffer, which is
+// transcoded one window at a time instead of as a whole. The positions are
+// offsets in the buffer divided by positionDivisor, so that they count bytes or
+// code units as the caller sees fit. Decoding stops at the first invalid code
+// unit sequence, which invalidSequence() reports once the reader gets there.
+template <typename Units>
+struct TranscodingInput {
+	using int_type = std::istream::int_type;
+	enum { eof = std::istream::traits_type::eof() };
+	enum { windowSize = 4096, maxBlockSize = 32 };
+
+	const char* const sourceBegin;
+	const char* source; // The next code unit to transcode
+	const char* sourceEnd;
+	const unsigned int positionDivisor;
+	bool invalid = false;
+
+	char window[windowSize];
+	const char* current = window;
+	const char* windowEnd = window;
+	size_t windowOffset; // Of the source of the first char of the window
+
+	// Where position() last got to, as the offsets are found by counting the
+	// code points from the start of the window
+	const char* counted = window;
+	size_t countedOffset;
+
+	TranscodingInput(const char* begin, const char* end, size_t skip, unsigned int positionDivisor)
+		: sourceBegin(begin), source(begin + skip), sourceEnd(end), positionDivisor(positionDivisor),
+		  windowOffset(skip), countedOffset(skip) {}
+
+	int_type get() {
+		if(current == windowEnd  &&  !refill()) {
+			return eof;
+		}
+		return static_cast<unsigned char>(*current++);
+	}
+
+	int_type peek() {
+		if(current == windowEnd  &&  !refill()) {
+			return eof;
+		}
+		return static_cast<unsigned char>(*current);
+	}
+
+	std::uint64_t position() {
+		return sourceOffset(current) / positionDivisor;
+	}
+
+	std::uint64_t previousPosition() {
+		return (current > window ? sourceOffset(current - 1) : windowOffset) / positionDivisor;
+	}
+
+	// The window holds valid UTF-8, from valid code points
+	void consumeStringRun(std::string* str, bool) {
+		while(true) {
+			const char* runEnd = findStringRunEnd(current, windowEnd, false);
+			if(str) {
+				str->append(current, runEnd);
+			}
+			current = runEnd;
+			if(current != windowEnd  ||  !refill()) {
+				return;
+			}
+		}
+	}
+
+	void skippedLineFeed() {}
+
+	bool invalidSequence(std::uint64_t& position) const {
+		position = (sourceEnd - sourceBegin) / positionDivisor;
+		return invalid;
+	}
+
+	void locate(std::uint64_t position, std::uint64_t& line, std::uint64_t& column) const {
+		const char* p = sourceBegin + position * positionDivisor;
+		const char* lineStart = sourceBegin;
+		line = 1;
+		for(const char* unit = sourceBegin; unit < p; unit += Units::size) {
+			if(Units::load(unit) == '\n') {
+				line++;
+				lineStart = unit + Units::size;
+			}
+		}
+		column = (p - lineStart) / positionDivisor + 1;
+	}
+
+	bool refill() {
+		windowOffset = source - sourceBegin;
+		char* out = window;
+		char* const outEnd = window + windowSize;
+		while(outEnd - out >= maxBlockSize  &&  source != sourceEnd) {
+#ifdef __SSE2__
+			if(sourceEnd - source >= 16  &&  Units::narrowASCII(source, out)) {
+				source += 16;
+				out += 16 / Units::size;
+				continue;
+			}
+#endif
+			// The code points of a block that is not all ASCII, which fit in
+			// maxBlockSize chars
+			const char* blockEnd = source + 16;
+			while(source < blockEnd  &&  source != sourceEnd) {
+				char32_t ch;
+				if(!Units::decode(source, sourceEnd, ch)) {
+					invalid = true;
+					sourceEnd = source;
+					break;
+				}
+				out = encodeUTF8(ch, out);
+			}
+		}
+
+		current = window;
+		windowEnd = out;
+		counted = window;
+		countedOffset = windowOffset;
+		return out != window;
+	}
+
+	size_t sourceOffset(const char* p) {
+		if(p < counted) {
+			counted = window;
+			countedOffset = windowOffset;
+		}
+		for(; counted < p; counted++) {
+			unsigned char byte = *counted;
+			if((byte & 0xC0) != 0x80) {
+				// A 4-byte UTF-8 sequence was a surrogate pair in UTF-16
+				countedOffset += (Units::size == 2  &&  byte >= 0xF0) ? 4 : Units::size;
+			}
+		}
+		return countedOffset;
+	}
+};
+
+struct ProjectionNode {
+	bool selected = false;
+	bool hasIndexes = false;
+	std::unordered_map<String, std::unique_ptr<ProjectionNode>> members;
+	std::unique_ptr<ProjectionNode> anyMember;
+
+	ProjectionNode& child(const String& token) {
+		std::unique_ptr<ProjectionNode>& node = (token == "*") ? anyMember : members[token];
+		if(!node) {
+			node.reset(new ProjectionNode);
+		}
+		if(!token.empty()  &&  std::all_of(token.begin(), token.end(), [](char ch) { return ch >= '0'  &&  ch <= '9'; })) {
+			hasIndexes = true;
+		}
+		return *node;
+	}
+
+	void merge(const ProjectionNode& other) {
+		selected = selected  ||  other.selected;
+		for(auto& member : other.members) {
+			child(member.first).merge(*member.second);
+		}
+		if(other.anyMember) {
+			child("*").merge(*other.anyMember);
+		}
+	}
+
+	// Makes the members with a specific key also match what "*" matches, so
+	// that a lookup needs to find a single node
+	void mergeAnyMember() {
+		for(auto& member : members) {
+			if(anyMember) {
+				member.second->merge(*anyMember);
+			}
+			member.second->mergeAnyMember();
+		}
+		if(anyMember) {
+			anyMember->mergeAnyMember();
+		}
+	}
+
+	const ProjectionNode* member(const String& key) const {
+		auto it = members.find(key);
+		return (it != members.end()) ? it->second.get() : anyMember.get();
+	}
+
+	const ProjectionNode* element(size_t index) const {
+		return hasIndexes ? member(decimalString(index)) : anyMember.get();
+	}
+};
+
+template <typename Input>
+struct BasicReader {
+	using istream = std::istream;
+	enum { eof = istream::traits_type::eof() };
+
+	Input input;
+	ParseOptions options;
+	ParseError error;
+
+	ReaderScratch ownScratch;
+	ReaderScratch* scratch = &ownScratch; // Or the one of a Parser
+
+	template <typename... Args>
+	BasicReader(Args&&... args) : input(std::forward<Args>(args)...) {}
+
+	// The read*(), skip*() and scan*() functions return false after recording
+	// the error, instead of throwing. check() turns the error into an exception.
+	void check(bool ok) {
+		if(!ok) {
+			reportedError().raise();
+		}
+	}
 
-	Reader(istream& is) : is(is) {}
+	// The error with its line and column, which are only found for the errors
+	// that get reported, by scanning the input again
+	const ParseError& reportedError() {
+		if(error.line == 0) {
+			input.locate(error.position, error.line, error.column);
+		}
+		return error;
+	}
 
-	Value readValue() {
+	bool readValue(Value& value) {
 		skipWhitespaces();
 		istream::int_type nextCh = nextChar();
 		switch(nextCh) {
-			case 'n': return readNull();
-			case 'f': return readBooleanFalse();
-			case 't': return readBooleanTrue();
-			case '"': return readString();
-			case '[': return readArray();
-			case '{': return readObject();
+			case 'n': return readToken("null")  &&  assign(value, null);
+			case 'f': return readToken("false") &&  assign(value, false);
+			case 't': return readToken("true")  &&  assign(value, true);
+			case '"': {
+				String string;
+				return readString(string)  &&  assign(value, std::move(string));
+			}
+			case '[': {
+				Array array;
+				return readArray(array)  &&  assign(value, std::move(array));
+			}
+			case '{': {
+				Object object;
+				return readObject(object)  &&  assign(value, std::move(object));
+			}
 			default:
 				if(isDigit(nextCh)  ||  nextCh == '-') {
-					return readNumber();
+					Number number;
+					return readNumber(number)  &&  assign(value, number);
 				}
-				throwUnexpectedNextChar();
+				return unexpectedNextChar();
 		}
 	}
 
-	Null readNull() {
-		readToken("null");
-		return null;
-	}
-
-	bool readBooleanFalse() {
-		readToken("false");
-		return false;
-	}
-
-	bool readBooleanTrue() {
-		readToken("true");
+	template <typename T>
+	static bool assign(Value& value, T&& newValue) {
+		value = Value(std::forward<T>(newValue));
 		return true;
 	}
 
-	void readToken(const char* token) {
+	bool readToken(const char* token) {
 		for(; *token != '\0'; token++) {
 			istream::int_type expectedCh = *token;
 			istream::int_type ch = extractChar();
 			if(ch != expectedCh) {
-				throwUnexpectedExtractedChar(ch);
+				return unexpectedExtractedChar(ch);
+			}
+		}
+		return true;
+	}
+
+	bool readNumber(Number& number) {
+		std::uint64_t position = input.position();
+		std::string& numberString = scratch->number;
+		numberString.clear();
+		Number::Type type;
+		if(!scanNumber(&numberString, type)) {
+			return false;
+		}
+
+		errno = 0;
+		if(type == Number::Type::IntegerNumber) {
+			number = std::strtoll(numberString.c_str(), nullptr, 10);
+			if(errno == ERANGE) {
+				return fail(ParseError::Kind::NumberOutOfRange, position);
+			}
+		} else {
+			number = std::strtold(numberString.c_str(), nullptr);
+			if(errno == ERANGE  &&  std::isinf(number.floatRef())) {
+				return fail(ParseError::Kind::NumberOutOfRange, position);
 			}
 		}
+		return true;
+	}
+
+	bool skipNumber() {
+		Number::Type type;
+		return scanNumber(nullptr, type);
 	}
 
-	Number readNumber() {
-		std::string numberString;
-		Number::Type type = Number::Type::IntegerNumber;
+	// The scan*() functions validate the input and append the characters they
+	// extract to the given string, unless it is null.
+	bool scanNumber(std::string* numberString, Number::Type& type) {
+		type = Number::Type::IntegerNumber;
 
 		if(nextChar() == '-') {
-			numberString += extractChar();
+			append(numberString, extractChar());
 		}
 
-		auto ch = readDigit();
-		numberString += ch;
-		if(ch != '0') {
-			numberString += readOptionalDigits();
+		istream::char_type digit;
+		if(!readDigit(digit)) {
+			return false;
+		}
+		append(numberString, digit);
+		if(digit != '0') {
+			scanOptionalDigits(numberString);
 		}
 
 		if(nextChar() == '.') {
-			numberString += extractChar();
+			append(numberString, extractChar());
 			type = Number::Type::FloatNumber;
-			numberString += readDigits();
+			if(!scanDigits(numberString)) {
+				return false;
+			}
 		}
 
-		ch = nextChar();
+		auto ch = nextChar();
 		if(ch == 'e'  ||  ch == 'E') {
-			numberString += extractChar();
+			append(numberString, extractChar());
 			type = Number::Type::FloatNumber;
 
 			ch = nextChar();
 			if(ch == '-'  ||  ch == '+') {
-				numberString += extractChar();
+				append(numberString, extractChar());
 			}
 
-			numberString += readDigits();
+			if(!scanDigits(numberString)) {
+				return false;
+			}
 		}
 
-		if(type == Number::Type::IntegerNumber) {
-			return std::stoll(numberString);
-		} else {
-			return std::stold(numberString);
-		}
+		return true;
 	}
 
-	std::string readDigits() {
-		std::string firstDigit = { readDigit() };
-		return firstDigit + readOptionalDigits();
+	bool scanDigits(std::string* digits) {
+		istream::char_type digit;
+		if(!readDigit(digit)) {
+			return false;
+		}
+		append(digits, digit);
+		scanOptionalDigits(digits);
+		return true;
 	}
 
-	istream::char_type readDigit() {
+	bool readDigit(istream::char_type& digit) {
 		istream::int_type ch = extractChar();
 		if(!isDigit(ch)) {
-			throwUnexpectedExtractedChar(ch);
+			return unexpectedExtractedChar(ch);
 		}
-		return ch;
+		digit = ch;
+		return true;
 	}
 
-	std::string readOptionalDigits() {
-		std::string digits;
+	void scanOptionalDigits(std::string* digits) {
 		while(isDigit(nextChar())) {
-			digits += extractChar();
+			append(digits, extractChar());
+		}
+	}
+
+	static void append(std::string* str, istream::char_type ch) {
+		if(str) {
+			*str += ch;
 		}
-		return digits;
 	}
 
-	std::string readString() {
-		std::string str;
+	bool readString(std::string& str) {
+		return scanString(&str);
+	}
+
+	bool skipString() {
+		return scanString(nullptr);
+	}
 
+	bool scanString(std::string* str) {
 		auto ch = extractChar();
 		if(ch != '"') {
-			throwUnexpectedExtractedChar(ch);
+			return unexpectedExtractedChar(ch);
 		}
 
-		bool finished = false;
-		do {
+		while(true) {
+			input.consumeStringRun(str, options.validateUTF8);
+
 			ch = extractChar();
 			if(ch == '"') {
-				finished = true;
+				return true;
 			} else if(ch == '\\') {
-				auto ch = readEscapedChar();
-				if(isLeadSurrogate(ch)) {
-					ch = completeUTF16Char(ch);
+				char32_t escapedCh;
+				if(!readEscapedChar(escapedCh)) {
+					return false;
+				}
+				if(isLeadSurrogate(escapedCh)  &&  !completeUTF16Char(escapedCh, escapedCh)) {
+					return false;
+				}
+				if(str) {
+					*str += utf8Encode(escapedCh);
+				}
+			} else if(ch >= 0x80  &&  options.validateUTF8) {
+				if(!scanUTF8Sequence(ch, str)) {
+					return false;
 				}
-				str += utf8Encode(ch);
 			} else if(ch >= 0x20) {
-				str += ch;
+				append(str, ch);
 			} else {
-				throwUnexpectedExtractedChar(ch);
+				return unexpectedExtractedChar(ch);
 			}
-		} while(!finished);
+		}
+	}
+
+	// Validates the rest of a multibyte UTF-8 sequence whose lead byte was just
+	// extracted, rejecting overlong forms, surrogates and code points above
+	// U+10FFFF.
+	bool scanUTF8Sequence(istream::int_type lead, std::string* str) {
+		std::uint64_t position = input.previousPosition();
+
+		int continuationBytes;
+		istream::int_type min = 0x80;
+		istream::int_type max = 0xBF;
+		if(lead >= 0xC2  &&  lead <= 0xDF) {
+			continuationBytes = 1;
+		} else if(lead >= 0xE0  &&  lead <= 0xEF) {
+			continuationBytes = 2;
+			if(lead == 0xE0) { min = 0xA0; }
+			if(lead == 0xED) { max = 0x9F; }
+		} else if(lead >= 0xF0  &&  lead <= 0xF4) {
+			continuationBytes = 3;
+			if(lead == 0xF0) { min = 0x90; }
+			if(lead == 0xF4) { max = 0x8F; }
+		} else {
+			return fail(ParseError::Kind::InvalidUTF8, position);
+		}
 
-		return str;
+		append(str, lead);
+		for(; continuationBytes > 0; continuationBytes--) {
+			istream::int_type ch = nextChar();
+			if(ch < min  ||  ch > max) {
+				return fail(ParseError::Kind::InvalidUTF8, position);
+			}
+			append(str, extractChar());
+			min = 0x80;
+			max = 0xBF;
+		}
+		return true;
 	}
 
-	char32_t completeUTF16Char(unsigned int lead) {
-		unsigned int position = positionNextChar;
+	bool completeUTF16Char(char32_t lead, char32_t& ch) {
+		std::uint64_t position = input.position();
 
-		auto ch = extractChar();
-		if(ch != '\\') {
-			throw ExpectedTrailCodePoint(position);
+		if(extractChar() != '\\') {
+			return fail(ParseError::Kind::ExpectedTrailCodePoint, position);
 		}
 
-		auto trail = readEscapedChar();
-		if(!isTrailSurrogate(trail)) {
-			throw ExpectedTrailCodePoint(position);
+		char32_t trail;
+		if(!readEscapedChar(trail)  ||  !isTrailSurrogate(trail)) {
+			return fail(ParseError::Kind::ExpectedTrailCodePoint, position);
 		}
 
 		ch  = (lead  - 0xD800) << 10;
 		ch |= (trail - 0xDC00);
 		ch += 0x010000;
 
-		return ch;
+		return true;
 	}
 
-	static bool isLeadSurrogate(istream::int_type ch) {
+	static bool isLeadSurrogate(char32_t ch) {
 		return ch >= 0xD800  &&  ch <= 0xDBFF;
 	}
 
-	static bool isTrailSurrogate(istream::int_type ch) {
+	static bool isTrailSurrogate(char32_t ch) {
 		return ch >= 0xDC00  &&  ch <= 0xDFFF;
 	}
 
-	char32_t readEscapedChar() {
+	bool readEscapedChar(char32_t& escapedCh) {
 		auto ch = extractChar();
 		switch(ch) {
 
 		case '"':
 		case '/':
 		case '\\':
-			return ch;
+			escapedCh = ch;
+			return true;
 
-		case 'b': return 0x08;
-		case 'f': return 0x0C;
-		case 'n': return 0x0A;
-		case 'r': return 0x0D;
-		case 't': return 0x09;
-		case 'u': return readHexCodePoint();
+		case 'b': escapedCh = 0x08; return true;
+		case 'f': escapedCh = 0x0C; return true;
+		case 'n': escapedCh = 0x0A; return true;
+		case 'r': escapedCh = 0x0D; return true;
+		case 't': escapedCh = 0x09; return true;
+		case 'u': return readHexCodePoint(escapedCh);
 
 		default:
-			throwUnexpectedExtractedChar(ch);
+			return unexpectedExtractedChar(ch);
 		}
 	}
 
-	char32_t readHexCodePoint() {
-		char32_t codePoint = 0;
+	bool readHexCodePoint(char32_t& codePoint) {
+		codePoint = 0;
 		for(int i = 0; i < 4; i++) {
 			int hexDigitValue;
 
@@ -262,12 +766,12 @@ struct Reader {
 			} else if(hexDigit >= 'A'  &&  hexDigit <= 'F') {
 				hexDigitValue = hexDigit - 'A' + 10;
 			} else {
-				throwUnexpectedExtractedChar(hexDigit);
+				return unexpectedExtractedChar(hexDigit);
 			}
 
 			codePoint = (codePoint << 4) + hexDigitValue;
 		}
-		return codePoint;
+		return true;
 	}
 
 	static std::string utf8Encode(char32_t ch) {
@@ -302,134 +806,601 @@ struct Reader {
 		}
 	}
 
-	Array readArray() {
+	bool readArray(Array& array) {
 		auto ch = extractChar();
 		if(ch != '[') {
-			throwUnexpectedExtractedChar(ch);
+			return unexpectedExtractedChar(ch);
 		}
 
 		skipWhitespaces();
 		ch = nextChar();
 		if(ch == ']') {
 			extractChar();
-			return emptyArray;
+			return true;
 		}
 
-		Array array;
 		while(true) {
-			Value value = readValue();
+			Value value;
+			if(!readValue(value)) {
+				return false;
+			}
 			array.push_back(std::move(value));
 
 			skipWhitespaces();
 			ch = extractChar();
 			if(ch == ']') {
-				break;
+				return true;
 			} else if(ch != ',') {
-				throwUnexpectedExtractedChar(ch);
+				return unexpectedExtractedChar(ch);
 			}
 		}
-		return array;
 	}
 
-	Object readObject() {
+	bool readObject(Object& object) {
 		auto ch = extractChar();
 		if(ch != '{') {
-			throwUnexpectedExtractedChar(ch);
+			return unexpectedExtractedChar(ch);
 		}
 
 		skipWhitespaces();
 		ch = nextChar();
 		if(ch == '}') {
 			extractChar();
-			return emptyObject;
+			return true;
 		}
 
-		Object object;
 		while(true) {
-			String key = readString();
-
-			skipWhitespaces();
-			ch = extractChar();
-			if(ch != ':') {
-				throwUnexpectedExtractedChar(ch);
+			String key;
+			Value value;
+			if(!readMemberKey(key)  ||  !readValue(value)) {
+				return false;
 			}
-
-			Value value = readValue();
 			auto pair = std::make_pair(std::move(key), std::move(value));
 			object.insert(std::move(pair));
 
 			skipWhitespaces();
 			ch = extractChar();
 			if(ch == '}') {
-				break;
+				return true;
 			} else if(ch != ',') {
-				throwUnexpectedExtractedChar(ch);
+				return unexpectedExtractedChar(ch);
 			}
 
 			skipWhitespaces();
 		}
-		return object;
 	}
 
-	void skipWhitespaces() {
-		do {
-			auto ch = nextChar();
-			if(isWhitespace(ch)) {
-				extractChar();
-			} else {
-				break;
-			}
-		} while(true);
-	}
+	bool readMemberKey(String& key) {
+		if(!readString(key)) {
+			return false;
+		}
 
-	istream::int_type extractChar() {
-		istream::int_type ch = is.get();
-		positionNextChar++;
-		return ch;
+		skipWhitespaces();
+		auto ch = extractChar();
+		if(ch != ':') {
+			return unexpectedExtractedChar(ch);
+		}
+		return true;
 	}
 
-	istream::int_type nextChar() {
-		return is.peek();
+	bool skipValue() {
+		skipWhitespaces();
+		istream::int_type nextCh = nextChar();
+		switch(nextCh) {
+			case 'n': return readToken("null");
+			case 'f': return readToken("false");
+			case 't': return readToken("true");
+			case '"': return skipString();
+			case '[': return skipArray();
+			case '{': return skipObject();
+			default:
+				if(isDigit(nextCh)  ||  nextCh == '-') {
+					return skipNumber();
+				}
+				return unexpectedNextChar();
+		}
 	}
 
-	static bool isValueFinalizer(istream::int_type ch) {
-		return isWhitespace(ch)  ||  ch == eof;
-	}
+	bool skipArray() {
+		extractChar(); // '['
 
-	static bool isWhitespace(istream::int_type ch) {
-		return ch == '\u0020'  // Space
-		    || ch == '\u0009'  // Tab
-		    || ch == '\u000A'  // Line feed
-		    || ch == '\u000D'  // Carriage return
-		    ;
-	}
+		skipWhitespaces();
+		if(nextChar() == ']') {
+			extractChar();
+			return true;
+		}
 
-	static bool isDigit(istream::int_type ch) {
-		return ch >= '0'  &&  ch <= '9';
-	}
+		while(true) {
+			if(!skipValue()) {
+				return false;
+			}
 
-	__attribute__((noreturn))
-	void throwUnexpectedNextChar() {
-		auto ch = nextChar();
-		throwUnexpectedChar(ch, positionNextChar);
+			skipWhitespaces();
+			auto ch = extractChar();
+			if(ch == ']') {
+				return true;
+			} else if(ch != ',') {
+				return unexpectedExtractedChar(ch);
+			}
+		}
 	}
 
-	__attribute__((noreturn))
-	void throwUnexpectedExtractedChar(istream::int_type ch) {
-		throwUnexpectedChar(ch, positionNextChar-1);
-	}
+	bool skipObject() {
+		extractChar(); // '{'
 
-	__attribute__((noreturn))
-	static void throwUnexpectedChar(istream::int_type ch, unsigned int position) {
-		if(ch == eof) {
-			throw IncompleteInput();
-		} else {
-			throw UnexpectedCharacter(ch, position);
+		skipWhitespaces();
+		if(nextChar() == '}') {
+			extractChar();
+			return true;
 		}
+
+		while(true) {
+			if(!skipMemberKey()  ||  !skipValue()) {
+				return false;
+			}
+
+			skipWhitespaces();
+			auto ch = extractChar();
+			if(ch == '}') {
+				return true;
+			} else if(ch != ',') {
+				return unexpectedExtractedChar(ch);
+			}
+
+			skipWhitespaces();
+		}
+	}
+
+	bool skipMemberKey() {
+		if(!skipString()) {
+			return false;
+		}
+
+		skipWhitespaces();
+		auto ch = extractChar();
+		if(ch != ':') {
+			return unexpectedExtractedChar(ch);
+		}
+		return true;
+	}
+
+	// Reads only what the projection selects. The value is left untouched and
+	// included is set to false if it was skipped.
+	bool readProjectedValue(const ProjectionNode& node, Value& value, bool& included) {
+		included = true;
+		if(node.selected) {
+			return readValue(value);
+		}
+
+		skipWhitespaces();
+		switch(nextChar()) {
+			case '[': {
+				Array array;
+				return readProjectedArray(node, array)  &&  assign(value, std::move(array));
+			}
+			case '{': {
+				Object object;
+				return readProjectedObject(node, object)  &&  assign(value, std::move(object));
+			}
+			default:
+				included = false;
+				return skipValue();
+		}
+	}
+
+	bool readProjectedArray(const ProjectionNode& node, Array& array) {
+		extractChar(); // '['
+
+		skipWhitespaces();
+		if(nextChar() == ']') {
+			extractChar();
+			return true;
+		}
+
+		for(size_t index = 0; ; index++) {
+			const ProjectionNode* element = node.element(index);
+			Value value;
+			bool included;
+			if(element ? !readProjectedValue(*element, value, included) : !skipValue()) {
+				return false;
+			}
+			array.push_back(std::move(value));
+
+			skipWhitespaces();
+			auto ch = extractChar();
+			if(ch == ']') {
+				return true;
+			} else if(ch != ',') {
+				return unexpectedExtractedChar(ch);
+			}
+		}
+	}
+
+	bool readProjectedObject(const ProjectionNode& node, Object& object) {
+		extractChar(); // '{'
+
+		skipWhitespaces();
+		if(nextChar() == '}') {
+			extractChar();
+			return true;
+		}
+
+		while(true) {
+			String key;
+			if(!readMemberKey(key)) {
+				return false;
+			}
+
+			const ProjectionNode* member = node.member(key);
+			if(member) {
+				Value value;
+				bool included;
+				if(!readProjectedValue(*member, value, included)) {
+					return false;
+				}
+				if(included) {
+					object.insert(std::make_pair(std::move(key), std::move(value)));
+				}
+			} else if(!skipValue()) {
+				return false;
+			}
+
+			skipWhitespaces();
+			auto ch = extractChar();
+			if(ch == '}') {
+				return true;
+			} else if(ch != ',') {
+				return unexpectedExtractedChar(ch);
+			}
+
+			skipWhitespaces();
+		}
+	}
+
+	// Reads into the existing value, keeping the capacity of its strings, the
+	// elements of its arrays and the members of its objects whose keys are
+	// found again. A value of another type is replaced.
+	bool readValueInto(Value& value) {
+		skipWhitespaces();
+		istream::int_type nextCh = nextChar();
+		switch(nextCh) {
+			case 'f':
+			case 't':
+				if(value.isBoolean()) {
+					bool boolean = (nextCh == 't');
+					if(!readToken(boolean ? "true" : "false")) {
+						return false;
+					}
+					value.asBoolean() = boolean;
+					return true;
+				}
+				return readValue(value);
+			case '"':
+				if(value.isString()) {
+					value.asString().clear();
+					return readString(value.asString());
+				}
+				return readValue(value);
+			case '[':
+				if(!value.isArray()) {
+					value = Array();
+				}
+				return readArrayInto(value.asArray());
+			case '{':
+				if(!value.isObject()) {
+					value = Object();
+				}
+				return readObjectInto(value.asObject());
+			default:
+				if(value.isNumber()  &&  (isDigit(nextCh)  ||  nextCh == '-')) {
+					return readNumber(value.asNumber());
+				}
+				return readValue(value);
+		}
+	}
+
+	bool readArrayInto(Array& array) {
+		extractChar(); // '['
+
+		skipWhitespaces();
+		if(nextChar() == ']') {
+			extractChar();
+			array.clear();
+			return true;
+		}
+
+		for(size_t count = 1; ; count++) {
+			if(array.size() < count) {
+				array.emplace_back();
+			}
+			if(!readValueInto(array[count - 1])) {
+				return false;
+			}
+
+			skipWhitespaces();
+			auto ch = extractChar();
+			if(ch == ']') {
+				array.resize(count);
+				return true;
+			} else if(ch != ',') {
+				return unexpectedExtractedChar(ch);
+			}
+		}
+	}
+
+	// The members that the input does not have are erased at the end. With
+	// duplicate keys, the first value wins, as with readObject(): the others
+	// are checked and skipped.
+	bool readObjectInto(Object& object) {
+		extractChar(); // '{'
+
+		skipWhitespaces();
+		if(nextChar() == '}') {
+			extractChar();
+			object.clear();
+			return true;
+		}
+
+		// The members of this object leave the scratch list on every exit, so
+		// that a failed parse does not leave it to grow from one to the next
+		std::vector<const Value*>& visitedMembers = scratch->visitedMembers;
+		std::unordered_set<const Value*>& visitedMemberSet = scratch->visitedMemberSet;
+		size_t firstVisited = visitedMembers.size();
+		struct VisitedMembersScope {
+			std::vector<const Value*>& members;
+			std::unordered_set<const Value*>& memberSet;
+			size_t first;
+			~VisitedMembersScope() {
+				for(size_t i = first; i < members.size(); i++) {
+					memberSet.erase(members[i]);
+				}
+				members.resize(first);
+			}
+		} visitedScope{visitedMembers, visitedMemberSet, firstVisited};
+
+		while(true) {
+			String& key = scratch->memberKey;
+			key.clear();
+			if(!readMemberKey(key)) {
+				return false;
+			}
+			auto it = object.find(key);
+			if(it == object.end()) {
+				it = object.emplace(key, Value()).first;
+			}
+			if(!visitedMemberSet.insert(&it->second).second) {
+				if(!skipValue()) {
+					return false;
+				}
+			} else {
+				visitedMembers.push_back(&it->second);
+				if(!readValueInto(it->second)) {
+					return false;
+				}
+			}
+
+			skipWhitespaces();
+			auto ch = extractChar();
+			if(ch == '}') {
+				break;
+			} else if(ch != ',') {
+				return unexpectedExtractedChar(ch);
+			}
+
+			skipWhitespaces();
+		}
+
+		if(visitedMembers.size() - firstVisited != object.size()) {
+			for(auto it = object.begin(); it != object.end(); ) {
+				if(visitedMemberSet.count(&it->second)) {
+					++it;
+				} else {
+					it = object.erase(it);
+				}
+			}
+		}
+		return true;
+	}
+
+	// Checks that nothing but whitespaces follow the value
+	bool readEnd() {
+		skipWhitespaces();
+		std::uint64_t position;
+		if(nextChar() != eof) {
+			return unexpectedNextChar();
+		} else if(input.invalidSequence(position)) {
+			return fail(ParseError::Kind::InvalidEncoding, position);
+		}
+		return true;
+	}
+
+	void skipWhitespaces() {
+		do {
+			auto ch = nextChar();
+			if(isWhitespace(ch)) {
+				extractChar();
+				if(ch == '\n') {
+					input.skippedLineFeed();
+				}
+			} else {
+				break;
+			}
+		} while(true);
+	}
+
+	istream::int_type extractChar() {
+		return input.get();
+	}
+
+	istream::int_type nextChar() {
+		return input.peek();
+	}
+
+	static bool isValueFinalizer(istream::int_type ch) {
+		return isWhitespace(ch)  ||  ch == eof;
+	}
+
+	static bool isWhitespace(istream::int_type ch) {
+		return ch == '\u0020'  // Space
+		    || ch == '\u0009'  // Tab
+		    || ch == '\u000A'  // Line feed
+		    || ch == '\u000D'  // Carriage return
+		    ;
+	}
+
+	static bool isDigit(istream::int_type ch) {
+		return ch >= '0'  &&  ch <= '9';
+	}
+
+	bool unexpectedNextChar() {
+		return unexpectedChar(nextChar(), input.position());
+	}
+
+	bool unexpectedExtractedChar(istream::int_type ch) {
+		return unexpectedChar(ch, input.previousPosition());
+	}
+
+	// An input that ends early at an invalid code unit sequence reports it
+	// rather than being incomplete
+	bool unexpectedChar(istream::int_type ch, std::uint64_t position) {
+		if(ch == eof) {
+			if(input.invalidSequence(position)) {
+				return fail(ParseError::Kind::InvalidEncoding, position);
+			}
+			return fail(ParseError::Kind::IncompleteInput, position);
+		} else {
+			return fail(ParseError::Kind::UnexpectedCharacter, position, ch);
+		}
+	}
+
+	bool fail(ParseError::Kind kind, std::uint64_t position, char character = '\0') {
+		error = ParseError(kind, position, character);
+		return false;
 	}
 
 };
 
+using Reader = BasicReader<StreamInput>;
+using BufferReader = BasicReader<BufferInput>;
+
+
+struct Span {
+	const char* begin;
+	const char* end;
+};
+
+inline bool isStructuralWhitespace(char ch) {
+	return ch == ' '  ||  ch == '\t'  ||  ch == '\n'  ||  ch == '\r';
+}
+
+inline const char* skipStructuralWhitespaces(const char* p, const char* end) {
+	while(p != end  &&  isStructuralWhitespace(*p)) {
+		p++;
+	}
+	return p;
+}
+
+// Returns the end of the string whose opening quote is at p, or null if the
+// string is not terminated. The contents are not validated.
+inline const char* skipStructuralString(const char* p, const char* end) {
+	for(p++; p != end; p++) {
+		if(*p == '"') {
+			return p + 1;
+		} else if(*p == '\\'  &&  ++p == end) {
+			break;
+		}
+	}
+	return nullptr;
+}
+
+// Returns the end of the value that starts at p by matching brackets, or null
+// if it is not terminated. Only strings and nesting are taken into account;
+// scalars extend up to the next delimiter.
+inline const char* skipStructuralValue(const char* p, const char* end) {
+	if(p == end) {
+		return nullptr;
+	}
+	if(*p == '"') {
+		return skipStructuralString(p, end);
+	}
+
+	unsigned int depth = 0;
+	for(; p != end; p++) {
+		char ch = *p;
+		if(ch == '"') {
+			p = skipStructuralString(p, end);
+			if(!p) {
+				return nullptr;
+			}
+			p--;
+		} else if(ch == '['  ||  ch == '{') {
+			depth++;
+		} else if(ch == ']'  ||  ch == '}') {
+			if(depth == 0) {
+				return p;
+			} else if(--depth == 0) {
+				return p + 1;
+			}
+		} else if(depth == 0  &&  (ch == ','  ||  isStructuralWhitespace(ch))) {
+			return p;
+		}
+	}
+	return depth == 0 ? p : nullptr;
+}
+
+// Finds the boundaries of the elements of a top level array with a quick scan
+// that only keeps track of strings and nesting depth. The elements themselves
+// are not validated. Returns false if the input does not have the shape of a
+// single array, in which case the regular parsing reports the proper error.
+inline bool splitTopLevelArray(const char* begin, const char* end, std::vector<Span>& elements) {
+	const char* p = skipStructuralWhitespaces(begin, end);
+	if(p == end  ||  *p != '[') {
+		return false;
+	}
+	p++;
+
+	const char* elementBegin = p;
+	unsigned int depth = 0;
+	for(; p != end; p++) {
+		char ch = *p;
+		if(ch == '"') {
+			p = skipStructuralString(p, end);
+			if(!p) {
+				return false;
+			}
+			p--;
+		} else if(ch == '['  ||  ch == '{') {
+			depth++;
+		} else if(ch == ']'  ||  ch == '}') {
+			if(depth > 0) {
+				depth--;
+			} else if(ch == ']') {
+				break;
+			} else {
+				return false;
+			}
+		} else if(ch == ','  &&  depth == 0) {
+			elements.push_back(Span{elementBegin, p});
+			elementBegin = p + 1;
+		}
+	}
+	if(p == end) {
+		return false;
+	}
+
+	const char* elementEnd = p;
+	if(!elements.empty()  ||  std::find_if_not(elementBegin, elementEnd, isStructuralWhitespace) != elementEnd) {
+		elements.push_back(Span{elementBegin, elementEnd});
+	}
+
+	for(p++; p != end; p++) {
+		if(!isStructuralWhitespace(*p)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 }
 
 
@@ -438,22 +1409,385 @@ inline std::istream& operator>>(std::istream& is, Value& value) {
 	return is;
 }
 
-inline Value parse(const std::string& str) {
-	std::istringstream is(str);
+namespace _details {
+
+struct ReadDocument {
+	template <typename Reader>
+	ParseResult operator()(Reader& reader) const {
+		Value result;
+		if(!reader.readValue(result)  ||  !reader.readEnd()) {
+			return reader.reportedError();
+		}
+		return std::move(result);
+	}
+};
+
+// The result holds no value, the target gets it
+struct ReadDocumentInto {
+	Value& target;
+
+	template <typename Reader>
+	ParseResult operator()(Reader& reader) const {
+		if(!reader.readValueInto(target)  ||  !reader.readEnd()) {
+			return reader.reportedError();
+		}
+		return Value();
+	}
+};
+
+template <typename Reader>
+ParseResult tryReadProjected(Reader& reader, const ProjectionNode& root, bool toEnd) {
+	Value result;
+	bool included;
+	if(!reader.readProjectedValue(root, result, included)  ||  (toEnd  &&  !reader.readEnd())) {
+		return reader.reportedError();
+	}
+	return std::move(result);
+}
+
+struct ReadProjectedDocument {
+	const ProjectionNode& root;
+
+	template <typename Reader>
+	ParseResult operator()(Reader& reader) const {
+		return tryReadProjected(reader, root, true);
+	}
+};
+
+template <typename Reader>
+void setUpReader(Reader& reader, const ParseOptions& options, ReaderScratch* scratch) {
+	reader.options = options;
+	if(scratch) {
+		reader.scratch = scratch;
+	}
+}
+
+template <typename Units, typename Action>
+ParseResult readTranscoded(const char* begin, const char* end, size_t skip, unsigned int positionDivisor,
+                           const ParseOptions& options, const Action& action, ReaderScratch* scratch) {
+	BasicReader<TranscodingInput<Units>> reader(begin, end, skip, positionDivisor);
+	setUpReader(reader, options, scratch);
+	return action(reader);
+}
+
+// Runs the action with a reader of the buffer in the given encoding, skipping
+// the first bytes (a byte order mark). The reader uses the given scratch
+// buffers, if any, instead of its own.
+template <typename Action>
+ParseResult readEncoded(Encoding encoding, const char* begin, const char* end, size_t skip,
+                        unsigned int positionDivisor, const ParseOptions& options, const Action& action,
+                        ReaderScratch* scratch = nullptr) {
+	switch(encoding) {
+	case Encoding::UTF16BE: return readTranscoded<UTF16Units<true>> (begin, end, skip, positionDivisor, options, action, scratch);
+	case Encoding::UTF16LE: return readTranscoded<UTF16Units<false>>(begin, end, skip, positionDivisor, options, action, scratch);
+	case Encoding::UTF32BE: return readTranscoded<UTF32Units<true>> (begin, end, skip, positionDivisor, options, action, scratch);
+	case Encoding::UTF32LE: return readTranscoded<UTF32Units<false>>(begin, end, skip, positionDivisor, options, action, scratch);
+	case Encoding::UTF8:
+		break;
+	}
+	BufferReader reader(begin + skip, end, skip);
+	setUpReader(reader, options, scratch);
+	return action(reader);
+}
+
+template <typename Action>
+ParseResult readDetected(const char* begin, const char* end, const ParseOptions& options, const Action& action,
+                         ReaderScratch* scratch = nullptr) {
+	size_t bomSize;
+	Encoding encoding = detectEncoding(begin, end, bomSize);
+	return readEncoded(encoding, begin, end, bomSize, 1, options, action, scratch);
+}
+
+template <typename Char>
+ParseResult tryParseWide(const std::basic_string<Char>& str, Encoding encoding, const ParseOptions& options) {
+	const char* begin = reinterpret_cast<const char*>(str.data());
+	const char* end = reinterpret_cast<const char*>(str.data() + str.size());
+	size_t skip = (!str.empty()  &&  str[0] == 0xFEFF) ? sizeof(Char) : 0;
+	return readEncoded(encoding, begin, end, skip, sizeof(Char), options, ReadDocument());
+}
+
+inline ParseResult tryParseBuffer(const char* begin, const char* end, const ParseOptions& options = ParseOptions()) {
+	return readDetected(begin, end, options, ReadDocument());
+}
+
+inline Value parseBuffer(const char* begin, const char* end, const ParseOptions& options = ParseOptions()) {
+	return tryParseBuffer(begin, end, options).value();
+}
+
+inline Value parseBufferParallel(const char* begin, const char* end, unsigned int threadCount,
+                                 const ParseOptions& options = ParseOptions()) {
+	if(threadCount == 0) {
+		threadCount = defaultThreadCount();
+	}
+
+	size_t bomSize;
+	std::vector<Span> elements;
+	if(threadCount == 1  ||  detectEncoding(begin, end, bomSize) != Encoding::UTF8  ||  bomSize > 0
+	   ||  !splitTopLevelArray(begin, end, elements)) {
+		return parseBuffer(begin, end, options);
+	}
+	if(elements.empty()) {
+		return emptyArray;
+	}
+
+	// The elements are parsed straight into their slots in the final array. A
+	// few chunks per thread leave room for balancing elements of uneven sizes.
+	Array array(elements.size());
+	size_t chunkCount = std::min<size_t>(elements.size(), size_t(threadCount) * 8);
+	size_t chunkSize = (elements.size() + chunkCount - 1) / chunkCount;
+	chunkCount = (elements.size() + chunkSize - 1) / chunkSize;
+
+	std::atomic<bool> invalid(false);
+	parallelFor(chunkCount, threadCount, [&](size_t chunk) {
+		size_t first = chunk * chunkSize;
+		size_t last = std::min(first + chunkSize, elements.size());
+		for(size_t i = first; i < last  &&  !invalid; i++) {
+			const Span& element = elements[i];
+			BufferReader reader(element.begin, element.end, element.begin - begin);
+			reader.options = options;
+			if(!reader.readValue(array[i])  ||  !reader.readEnd()) {
+				invalid = true;
+			}
+		}
+	});
+
+	if(invalid) {
+		// Let the serial parser find and report the first error
+		return parseBuffer(begin, end, options);
+	}
+	return array;
+}
+
+}
+
+inline Value parse(const std::string& str, const ParseOptions& options) {
+	return _details::parseBuffer(str.data(), str.data() + str.size(), options);
+}
+
+inline Value parse(const std::u16string& str, const ParseOptions& options) {
+	return tryParse(str, options).value();
+}
+
+inline Value parse(const std::u32string& str, const ParseOptions& options) {
+	return tryParse(str, options).value();
+}
+
+inline void parseInto(Value& target, const std::string& str, const ParseOptions& options) {
+	Parser(options).parseInto(target, str);
+}
+
+inline void parseInto(Value& target, std::istream& is, const ParseOptions& options) {
+	Parser(options).parseInto(target, is);
+}
+
+inline Value parseParallel(const std::string& str, unsigned int threadCount, const ParseOptions& options) {
+	return _details::parseBufferParallel(str.data(), str.data() + str.size(), threadCount, options);
+}
+
+inline Value readFrom(std::istream& is, const ParseOptions& options) {
+	return tryReadFrom(is, options).value();
+}
+
+inline ParseResult tryParse(const std::string& str, const ParseOptions& options) {
+	return _details::tryParseBuffer(str.data(), str.data() + str.size(), options);
+}
+
+inline ParseResult tryParse(const std::u16string& str, const ParseOptions& options) {
+	return _details::tryParseWide(str, _details::nativeUTF16, options);
+}
+
+inline ParseResult tryParse(const std::u32string& str, const ParseOptions& options) {
+	return _details::tryParseWide(str, _details::nativeUTF32, options);
+}
+
+inline ParseResult tryReadFrom(std::istream& is, const ParseOptions& options) {
+	return Parser(options).tryReadFrom(is);
+}
+
+inline BatchParser::BatchParser(unsigned int threadCount, const ParseOptions& options)
+	: options(options), pool(new _details::WorkerPool(threadCount > 0 ? threadCount : _details::defaultThreadCount())) {
+	parsers.resize(size_t(pool->threadCount()) * 8);
+}
+
+inline BatchParser::~BatchParser() {}
+
+inline unsigned int BatchParser::threadCount() const {
+	return pool->threadCount();
+}
+
+inline std::vector<ParseResult> BatchParser::parse(const std::vector<BatchDocument>& documents) {
+	// The documents are parsed a chunk at a time, a few chunks per thread to
+	// balance uneven documents, each chunk with one parser
+	std::vector<ParseResult> results(documents.size(), ParseResult(Value()));
+	size_t chunkCount = std::min<size_t>(documents.size(), parsers.size());
+	if(chunkCount == 0) {
+		return results;
+	}
+	size_t chunkSize = (documents.size() + chunkCount - 1) / chunkCount;
+	chunkCount = (documents.size() + chunkSize - 1) / chunkSize;
+
+	pool->parallelFor(chunkCount, [&](size_t chunk) {
+		Parser& parser = parsers[chunk];
+		parser.options = options;
+		size_t last = std::min((chunk + 1) * chunkSize, documents.size());
+		for(size_t i = chunk * chunkSize; i < last; i++) {
+			results[i] = parser.tryParse(documents[i].data, documents[i].size);
+		}
+	});
+	return results;
+}
+
+inline std::vector<ParseResult> BatchParser::parse(const std::vector<std::string>& documents) {
+	return parse(std::vector<BatchDocument>(documents.begin(), documents.end()));
+}
+
+namespace _details {
+
+// The batch parser of parseBatch(), created by the first call that uses it
+struct SharedBatchParser {
+	std::mutex mutex; // Held by the call that parses on it
+	BatchParser parser;
+};
+
+inline SharedBatchParser& sharedBatchParser() {
+	static SharedBatchParser shared;
+	return shared;
+}
+
+}
+
+inline std::vector<ParseResult> parseBatch(const std::vector<BatchDocument>& documents, unsigned int threadCount,
+                                           const ParseOptions& options) {
+	if(threadCount == 0) {
+		threadCount = _details::defaultThreadCount();
+	}
+	if(threadCount == _details::defaultThreadCount()) {
+		_details::SharedBatchParser& shared = _details::sharedBatchParser();
+		std::unique_lock<std::mutex> lock(shared.mutex, std::try_to_lock);
+		if(lock.owns_lock()) {
+			shared.parser.options = options;
+			return shared.parser.parse(documents);
+		}
+	}
+	return BatchParser(threadCount, options).parse(documents);
+}
+
+inline std::vector<ParseResult> parseBatch(const std::vector<std::string>& documents, unsigned int threadCount,
+                                           const ParseOptions& options) {
+	return parseBatch(std::vector<BatchDocument>(documents.begin(), documents.end()), threadCount, options);
+}
+
+
+inline Value Parser::parse(const std::string& str) {
+	return tryParse(str).value();
+}
+
+inline Value Parser::parse(const char* data, size_t size) {
+	return tryParse(data, size).value();
+}
+
+inline Value Parser::readFrom(std::istream& is) {
+	return tryReadFrom(is).value();
+}
+
+inline void Parser::parseInto(Value& target, const std::string& str) {
+	_details::ReadDocumentInto action{target};
+	_details::readDetected(str.data(), str.data() + str.size(), options, action, &scratch).error().raise();
+}
+
+inline void Parser::parseInto(Value& target, std::istream& is) {
 	_details::Reader reader(is);
-	Value result = reader.readValue();
+	_details::setUpReader(reader, options, &scratch);
+	reader.check(reader.readValueInto(target));
+}
+
+inline ParseResult Parser::tryParse(const std::string& str) {
+	return tryParse(str.data(), str.size());
+}
+
+inline ParseResult Parser::tryParse(const char* data, size_t size) {
+	return _details::readDetected(data, data + size, options, _details::ReadDocument(), &scratch);
+}
+
+inline ParseResult Parser::tryReadFrom(std::istream& is) {
+	_details::Reader reader(is);
+	_details::setUpReader(reader, options, &scratch);
+	Value result;
+	if(!reader.readValue(result)) {
+		return reader.reportedError();
+	}
+	return std::move(result);
+}
+
 
-	reader.skipWhitespaces();
-	if(!is.eof()) {
-		reader.throwUnexpectedNextChar();
+inline Projection::Projection(std::initializer_list<std::string> paths) {
+	for(auto& path : paths) {
+		this->paths.push_back(splitPath(path));
 	}
+	compile();
+}
+
+inline Projection& Projection::add(const std::string& path) {
+	paths.push_back(splitPath(path));
+	compile();
+	return *this;
+}
+
+inline std::vector<String> Projection::splitPath(const std::string& path) {
+	if(!path.empty()  &&  path[0] != '/') {
+		throw InvalidProjectionPath(path);
+	}
+
+	// Split the tokens and unescape them ("~1" is '/' and "~0" is '~')
+	std::vector<String> tokens;
+	for(size_t i = 0; i < path.size(); i++) {
+		char ch = path[i];
+		if(ch == '/') {
+			tokens.emplace_back();
+		} else if(ch == '~') {
+			if(i + 1 < path.size()  &&  (path[i+1] == '0'  ||  path[i+1] == '1')) {
+				tokens.back() += (path[++i] == '0') ? '~' : '/';
+			} else {
+				throw InvalidProjectionPath(path);
+			}
+		} else {
+			tokens.back() += ch;
+		}
+	}
+
+	return tokens;
+}
+
+inline void Projection::compile() {
+	std::shared_ptr<_details::ProjectionNode> root(new _details::ProjectionNode);
+	for(auto& tokens : paths) {
+		_details::ProjectionNode* node = root.get();
+		for(auto& token : tokens) {
+			node = &node->child(token);
+		}
+		node->selected = true;
+	}
+	root->mergeAnyMember();
+	this->root = root;
+}
+
+inline Value parse(const std::string& str, const Projection& projection, const ParseOptions& options) {
+	return tryParse(str, projection, options).value();
+}
+
+inline Value readFrom(std::istream& is, const Projection& projection, const ParseOptions& options) {
+	return tryReadFrom(is, projection, options).value();
+}
 
-	return result;
+inline ParseResult tryParse(const std::string& str, const Projection& projection, const ParseOptions& options) {
+	_details::ReadProjectedDocument action{*projection.root};
+	return _details::readDetected(str.data(), str.data() + str.size(), options, action);
 }
 
-inline Value readFrom(std::istream& is) {
+inline ParseResult tryReadFrom(std::istream& is, const Projection& projection, const ParseOptions& options) {
 	_details::Reader reader(is);
-	return reader.readValue();
+	reader.options = options;
+	return _details::tryReadProjected(reader, *projection.root, false);
 }
 
 }
@@ -0,0 +1,235 @@
+#ifndef SINK_HPP_
+#define SINK_HPP_
+
+
+#include "values.hpp"
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+
+namespace nosj {
+
+
+class WriteError : public Exception {
+public:
+	int error; // errno value
+	WriteError(int error) : error(error) {}
+	virtual const char* what() const noexcept override { return "Write error"; }
+};
+
+
+// The sinks take the output of the writers into a buffer, by bumping a pointer,
+// and only call the derived sink when the buffer is full. Derived sinks set
+// current and end, and define makeRoom(size), which must leave room for at
+// least size bytes, up to maxReserve. They may also define writeLarge() to
+// take data that does not fit in the buffer in another way than a buffer at a
+// time.
+template <typename Derived>
+class BasicSink {
+public:
+	enum { maxReserve = 64 };
+
+	void put(char ch) {
+		if(current == end) {
+			derived().makeRoom(1);
+		}
+		*current++ = ch;
+	}
+
+	void write(const char* data, size_t size) {
+		if(size_t(end - current) >= size) {
+			std::memcpy(current, data, size);
+			current += size;
+		} else {
+			derived().writeLarge(data, size);
+		}
+	}
+
+	void write(const char* str) {
+		write(str, std::strlen(str));
+	}
+
+	// Data that stays valid until the sink is flushed, which a sink may
+	// reference where it is instead of copying it
+	void writeLasting(const char* data, size_t size) {
+		derived().writeLastingData(data, size);
+	}
+
+	// Room to write up to size bytes (at most maxReserve) straight into the
+	// buffer, then commit() the end of what was written
+	char* reserve(size_t size) {
+		if(size_t(end - current) < size) {
+			derived().makeRoom(size);
+		}
+		return current;
+	}
+
+	void commit(char* newCurrent) {
+		current = newCurrent;
+	}
+
+protected:
+	char* current = nullptr;
+	char* end = nullptr;
+
+	BasicSink() {}
+	BasicSink(const BasicSink&) = delete;
+	BasicSink& operator=(const BasicSink&) = delete;
+
+	Derived& derived() { return static_cast<Derived&>(*this); }
+
+	void writeLarge(const char* data, size_t size);
+	void writeLastingData(const char* data, size_t size) { write(data, size); }
+};
+
+// Appends to a string, which it grows geometrically. The string is longer than
+// the output until flush(), which the destructor calls too.
+class StringSink : public BasicSink<StringSink> {
+public:
+	explicit StringSink(std::string& output) : output(output) {}
+	~StringSink() { flush(); }
+
+	void flush();
+	// Of the output so far, which the string holds from its start
+	size_t size() const { return current ? current - &output[0] : output.size(); }
+
+private:
+	std::string& output;
+
+	void makeRoom(size_t size);
+	friend class BasicSink<StringSink>;
+};
+
+// Writes into a buffer of the caller. What does not fit is counted but dropped.
+// Near the end of the buffer, reserve() goes to a scratch area, of which
+// flush() copies back what fits: flush before reading the buffer.
+class FixedBufferSink : public BasicSink<FixedBufferSink> {
+public:
+	FixedBufferSink(char* buffer, size_t capacity);
+
+	void flush();
+
+	// Whether all the output fits in the buffer
+	bool fits() const { return size() <= capacity; }
+	// The size of the whole output, even when it does not fit
+	size_t size() const;
+
+private:
+	char* const buffer;
+	const size_t capacity;
+	char overflow[maxReserve];
+	bool spilling = false; // Whether the output goes to overflow
+	size_t bufferedSize = 0;
+	size_t droppedSize = 0;
+
+	void makeRoom(size_t size);
+	friend class BasicSink<FixedBufferSink>;
+};
+
+// Counts the output without keeping it
+class CountingSink : public BasicSink<CountingSink> {
+public:
+	CountingSink() {
+		current = scratch;
+		end = scratch + maxReserve;
+	}
+
+	size_t size() const { return counted + (current - scratch); }
+
+	// Counts output of the given size without writing it
+	void skip(size_t size) { counted += size; }
+
+private:
+	char scratch[maxReserve];
+	size_t counted = 0;
+
+	void makeRoom(size_t);
+	void writeLarge(const char*, size_t size) { counted += size; }
+	void writeLastingData(const char*, size_t size) { counted += size; }
+	friend class BasicSink<CountingSink>;
+};
+
+// Writes to a stream a block at a time. flush() writes what is buffered to the
+// stream, without flushing the stream itself; the destructor calls it too.
+class StreamSink : public BasicSink<StreamSink> {
+public:
+	explicit StreamSink(std::ostream& os) : os(os) {
+		current = buffer;
+		end = buffer + bufferSize;
+	}
+	~StreamSink() { flush(); }
+
+	void flush();
+
+private:
+	enum { bufferSize = 4096 };
+
+	std::ostream& os;
+	char buffer[bufferSize];
+
+	void makeRoom(size_t) { flush(); }
+	void writeLarge(const char* data, size_t size);
+	friend class BasicSink<StreamSink>;
+};
+
+// Writes to a file descriptor a block at a time, and throws WriteError if it
+// cannot. The destructor flushes too, but ignores the errors.
+class FileDescriptorSink : public BasicSink<FileDescriptorSink> {
+public:
+	explicit FileDescriptorSink(int fd);
+	~FileDescriptorSink() noexcept;
+
+	void flush();
+
+private:
+	enum { bufferSize = 64 * 1024 };
+
+	int fd;
+	std::unique_ptr<char[]> buffer;
+
+	void makeRoom(size_t) { flush(); }
+	void writeLarge(const char* data, size_t size);
+	void writeAll(const char* data, size_t size);
+	friend class BasicSink<FileDescriptorSink>;
+};
+
+// Writes to a file descriptor with writev(), as a list of segments: parts of its
+// buffer, and the long runs of strings where they are in the values, so large
+// strings are never copied. flush() before the values change, or are
+// destroyed. It throws WriteError if it cannot write; the destructor flushes
+// too, but ignores the errors.
+class GatherSink : public BasicSink<GatherSink> {
+public:
+	explicit GatherSink(int fd);
+	~GatherSink() noexcept;
+
+	void flush();
+
+private:
+	enum { bufferSize = 64 * 1024, referenceSize = 4096 };
+
+	int fd;
+	std::unique_ptr<char[]> buffer;
+	char* segmentStart; // Of the part of the buffer not in segments yet
+	std::vector<iovec> segments;
+
+	void makeRoom(size_t) { flush(); }
+	void writeLastingData(const char* data, size_t size);
+	void endSegment();
+	void writeSegments(iovec* segments, size_t count);
+	friend class BasicSink<GatherSink>;
+};
+
+
+}
+
+
+#include "sink.inl"
+
+
+#endif /* SINK_HPP_ */
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <unistd.h>
+
+
+namespace nosj {
+
+
+// A buffer at a time, so that the derived sinks need only makeRoom()
+template <typename Derived>
+void BasicSink<Derived>::writeLarge(const char* data, size_t size) {
+	while(true) {
+		size_t room = std::min<size_t>(end - current, size);
+		std::memcpy(current, data, room);
+		current += room;
+		data += room;
+		size -= room;
+		if(size == 0) {
+			return;
+		}
+		derived().makeRoom(1);
+	}
+}
+
+
+inline void StringSink::flush() {
+	if(current) {
+		output.resize(current - &output[0]);
+		current = end = nullptr;
+	}
+}
+
+inline void StringSink::makeRoom(size_t size) {
+	size_t length = current ? current - &output[0] : output.size();
+	output.resize(std::max<size_t>({length + size, 2 * length, 256}));
+	current = &output[0] + length;
+	end = &output[0] + output.size();
+}
+
+
+inline FixedBufferSink::FixedBufferSink(char* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {
+	current = buffer;
+	end = buffer + capacity;
+}
+
+inline void FixedBufferSink::flush() {
+	if(spilling) {
+		size_t size = current - overflow;
+		size_t copied = std::min(size, capacity - bufferedSize);
+		if(copied > 0) {
+			std::memcpy(buffer + bufferedSize, overflow, copied);
+		}
+		bufferedSize += copied;
+		droppedSize += size - copied;
+		current = overflow;
+	}
+}
+
+inline size_t FixedBufferSink::size() const {
+	if(spilling) {
+		return bufferedSize + droppedSize + (current - overflow);
+	}
+	return current - buffer;
+}
+
+inline void FixedBufferSink::makeRoom(size_t) {
+	if(spilling) {
+		flush();
+	} else {
+		spilling = true;
+		bufferedSize = current - buffer;
+	}
+	current = overflow;
+	end = overflow + maxReserve;
+}
+
+
+inline void CountingSink::makeRoom(size_t) {
+	counted += current - scratch;
+	current = scratch;
+}
+
+
+inline void StreamSink::flush() {
+	os.write(buffer, current - buffer);
+	current = buffer;
+}
+
+inline void StreamSink::writeLarge(const char* data, size_t size) {
+	flush();
+	os.write(data, size);
+}
+
+
+inline FileDescriptorSink::FileDescriptorSink(int fd) : fd(fd), buffer(new char[bufferSize]) {
+	current = buffer.get();
+	end = buffer.get() + bufferSize;
+}
+
+inline FileDescriptorSink::~FileDescriptorSink() noexcept {
+	try {
+		flush();
+	} catch(WriteError&) {
+	}
+}
+
+inline void FileDescriptorSink::flush() {
+	size_t size = current - buffer.get();
+	current = buffer.get(); // Dropped if it cannot be written
+	writeAll(buffer.get(), size);
+}
+
+inline void FileDescriptorSink::writeLarge(const char* data, size_t size) {
+	flush();
+	writeAll(data, size);
+}
+
+inline void FileDescriptorSink::writeAll(const char* data, size_t size) {
+	while(size > 0) {
+		ssize_t count = ::write(fd, data, size);
+		if(count < 0  &&  errno == EINTR) {
+			continue;
+		} else if(count < 0) {
+			throw WriteError(errno);
+		}
+		data += count;
+		size -= count;
+	}
+}
+
+
+inline GatherSink::GatherSink(int fd) : fd(fd), buffer(new char[bufferSize]) {
+	current = segmentStart = buffer.get();
+	end = buffer.get() + bufferSize;
+}
+
+inline GatherSink::~GatherSink() noexcept {
+	try {
+		flush();
+	} catch(WriteError&) {
+	}
+}
+
+inline void GatherSink::flush() {
+	endSegment();
+	current = segmentStart = buffer.get();
+
+	// Dropped if they cannot be written
+	std::vector<iovec> pending;
+	pending.swap(segments);
+	writeSegments(pending.data(), pending.size());
+	pending.clear();
+	segments.swap(pending);
+}
+
+inline void GatherSink::writeLastingData(const char* data, size_t size) {
+	if(size < referenceSize) {
+		write(data, size);
+		return;
+	}
+	endSegment();
+	segments.push_back(iovec{const_cast<char*>(data), size});
+}
+
+inline void GatherSink::endSegment() {
+	if(current != segmentStart) {
+		segments.push_back(iovec{segmentStart, size_t(current - segmentStart)});
+		segmentStart = current;
+	}
+}
+
+inline void GatherSink::writeSegments(iovec* segments, size_t count) {
+	while(count > 0) {
+		ssize_t written = ::writev(fd, segments, std::min<size_t>(count, IOV_MAX));
+		if(written < 0  &&  errno == EINTR) {
+			continue;
+		} else if(written < 0) {
+			throw WriteError(errno);
+		}
+
+		// Skip what was written, which may end in the middle of a segment
+		while(count > 0  &&  size_t(written) >= segments->iov_len) {
+			written -= segments->iov_len;
+			segments++;
+			count--;
+		}
+		if(written > 0) {
+			segments->iov_base = static_cast<char*>(segments->iov_base) + written;
+			segments->iov_len -= written;
+		}
+	}
+}
+
+
+}
@@ -2,8 +2,13 @@
 #define STRINGIFY_HPP_
 
 
+#include "encoding.hpp"
+#include "sink.hpp"
 #include "values.hpp"
 #include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 
 namespace nosj {
@@ -12,16 +17,108 @@ namespace nosj {
 namespace _details {
 	class StringifiableValue;
 	std::ostream& operator<<(std::ostream&, const StringifiableValue&);
+
+	// What a StringifyCache keeps of an array or object of the document
+	struct SerializedContainer {
+		const Value* parent;                  // Null at the top
+		std::vector<const Value*> containers; // The arrays and objects right in it
+		size_t indentLevel;
+		bool kept;                            // Whether the output is still that of the value
+		std::string output;
+	};
 }
 
 
+struct StringifyOptions {
+	// Break lines and indent
+	bool pretty;
+	// Escape the non-ASCII characters as \uXXXX, with surrogate pairs beyond
+	// U+FFFF, for the consumers that only take ASCII. Invalid UTF-8 becomes
+	// \uFFFD.
+	bool asciiOnly;
+
+	// The layout of pretty output: the indentation of each level, what goes
+	// between keys and values, and the most elements and members of the arrays
+	// and objects that are not broken on lines (their own values may be)
+	size_t indentWidth;
+	char indentChar;
+	std::string keySeparator;
+	size_t inlineArraySize;
+	size_t inlineObjectSize;
+
+	StringifyOptions()
+		: pretty(false), asciiOnly(false), indentWidth(3), indentChar(' '), keySeparator(" : "), inlineArraySize(1),
+		  inlineObjectSize(0) {}
+};
+
+
+// Writes a document again and again, keeping the output of its arrays and
+// objects from one call to the next and copying those that have not changed, so
+// that writing a large document after a small change costs about the size of
+// what changed. The values are known by their address, and the cache does not
+// see them change: after changing the document, and before writing it again,
+// call invalidate() with the innermost array or object that holds each change,
+// be it a value changed in place, replaced, added or removed. The cache takes
+// about the size of the output for each level of nesting. It is meant for one
+// document, and must not be used by several threads at once.
+class StringifyCache {
+public:
+	StringifyOptions options;
+
+	StringifyCache() {}
+	explicit StringifyCache(const StringifyOptions& options) : options(options) {}
+
+	std::string stringify(const Value&);
+	// Drops the output of the array or object, of all that it holds and of the
+	// arrays and objects that hold it. Other values, and those that the cache
+	// has not written, drop all of it.
+	void invalidate(const Value&);
+	void clear();
+
+private:
+	std::unordered_map<const Value*, _details::SerializedContainer> containers;
+	std::string layout; // Of the options that the outputs were written with
+};
+
+
 _details::StringifiableValue pretty(const Value&);
 _details::StringifiableValue nopretty(const Value&);
 
 std::ostream& operator<<(std::ostream&, const Value&);
 
+// Floats are written with the fewest digits that parse back to the same value,
+// and infinities and NaN, which JSON lacks, as null
 std::string stringify(const Value&, bool pretty = false);
+std::string stringify(const Value&, const StringifyOptions&);
+// The same output as stringify(), with the elements and members of large arrays
+// and objects written on several threads (all the hardware threads if
+// threadCount is 0)
+std::string stringifyParallel(const Value&, unsigned int threadCount = 0, const StringifyOptions& = StringifyOptions());
 void writeTo(std::ostream&, const Value&, bool pretty = false);
+void writeTo(std::ostream&, const Value&, const StringifyOptions&);
+// The exact size of the output of stringify(), found by walking the value
+// with the widths of numbers instead of their digits
+size_t serializedSize(const Value&, bool pretty = false);
+size_t serializedSize(const Value&, const StringifyOptions&);
+// Write into a buffer of the caller, without terminating null, and return the
+// size of the output. Like snprintf(), if that size is more than the capacity,
+// nothing is written past it: the buffer holds a prefix of the output and may
+// be retried with the returned size.
+size_t stringifyTo(char* buffer, size_t capacity, const Value&, bool pretty = false);
+size_t stringifyTo(char* buffer, size_t capacity, const Value&, const StringifyOptions&);
+// Write to any sink (see sink.hpp), which the caller flushes
+template <typename Sink>
+void writeTo(BasicSink<Sink>&, const Value&, bool pretty = false);
+template <typename Sink>
+void writeTo(BasicSink<Sink>&, const Value&, const StringifyOptions&);
+
+// Generate the JSON text in UTF-16 or UTF-32, as code units or as bytes in the
+// given encoding. The bytes of strings that are not valid UTF-8 are replaced by
+// U+FFFD; with Encoding::UTF8 they are written as they are.
+std::string    stringify(const Value&, Encoding, bool pretty = false);
+std::u16string stringifyUTF16(const Value&, bool pretty = false);
+std::u32string stringifyUTF32(const Value&, bool pretty = false);
+void writeTo(std::ostream&, const Value&, Encoding, bool pretty = false);
 
 
 }
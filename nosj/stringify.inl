@@ -1,4 +1,16 @@
-#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include "float.inl"
+#include "parallel.inl"
 
 namespace nosj {
 
@@ -15,164 +27,889 @@ inline std::ostream& operator<<(std::ostream& os, const StringifiableValue& sv)
 	return os;
 }
 
+// The most chars that writeFloat() writes, with a null after them: a sign, 21
+// digits, a point and an exponent of up to 4 digits, or 21 digits after "0.0000"
+const size_t floatSize = 32;
+
+// The digits of 00 to 99
+const char digitPairs[] =
+	"00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839"
+	"40414243444546474849" "50515253545556575859" "60616263646566676869" "70717273747576777879"
+	"80818283848586878889" "90919293949596979899";
+
+inline unsigned int countDigits(unsigned long long n) {
+	static const unsigned long long powersOf10[] = {
+		0, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000ULL,
+		100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+		10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+	};
+	// log10(n) is about log2(n) * 1233 / 4096, and at most one too big
+	unsigned int log10 = (64 - __builtin_clzll(n | 1)) * 1233 >> 12;
+	return log10 + 1 - (n < powersOf10[log10]);
+}
+
+// Writes the digits of n at out, two at a time from the end, and returns their
+// end
+inline char* writeUnsigned(unsigned long long n, char* out) {
+	char* end = out + countDigits(n);
+	char* p = end;
+	while(n >= 100) {
+		const char* pair = digitPairs + (n % 100) * 2;
+		n /= 100;
+		*--p = pair[1];
+		*--p = pair[0];
+	}
+	if(n >= 10) {
+		*--p = digitPairs[n * 2 + 1];
+		*--p = digitPairs[n * 2];
+	} else {
+		*--p = '0' + n;
+	}
+	return end;
+}
+
+inline char* writeInteger(long long n, char* out) {
+	unsigned long long magnitude = n;
+	if(n < 0) {
+		*out++ = '-';
+		magnitude = 0 - magnitude;
+	}
+	return writeUnsigned(magnitude, out);
+}
+
+// Writes the digits * 10^exponent, the exponent being that of the last digit,
+// in the layout of printf("%.16g"), with a fractional part for integral values,
+// so that they read back as floats, and returns its end
+inline char* writeDecimalDigits(const char* digits, int count, int exponent, char* out) {
+	int firstExponent = exponent + count - 1; // Of the first digit
+	if(firstExponent < -4  ||  firstExponent >= 16) {
+		*out++ = digits[0];
+		if(count > 1) {
+			*out++ = '.';
+			out = std::copy(digits + 1, digits + count, out);
+		}
+		*out++ = 'e';
+		*out++ = firstExponent < 0 ? '-' : '+';
+		unsigned int magnitude = firstExponent < 0 ? -firstExponent : firstExponent;
+		if(magnitude < 10) {
+			*out++ = '0';
+		}
+		return writeUnsigned(magnitude, out);
+	} else if(exponent >= 0) {
+		out = std::fill_n(std::copy(digits, digits + count, out), exponent, '0');
+		*out++ = '.';
+		*out++ = '0';
+		return out;
+	} else if(firstExponent >= 0) {
+		out = std::copy(digits, digits + firstExponent + 1, out);
+		*out++ = '.';
+		return std::copy(digits + firstExponent + 1, digits + count, out);
+	} else {
+		*out++ = '0';
+		*out++ = '.';
+		return std::copy(digits, digits + count, std::fill_n(out, -firstExponent - 1, '0'));
+	}
+}
+
+inline char* writeDecimal(std::uint64_t digits, int exponent, char* out) {
+	char buffer[20];
+	int count = writeUnsigned(digits, buffer) - buffer;
+	return writeDecimalDigits(buffer, count, exponent, out);
+}
+
+// Rounds the significant digits to the given number of them, half up, without
+// the trailing zeros, and returns how many are left. A carry past the first
+// digit makes it 1 and raises the exponent of the first digit.
+inline int roundDigits(const char* digits, int count, int precision, char* rounded, int& firstExponent) {
+	if(precision >= count) {
+		std::copy(digits, digits + count, rounded);
+		precision = count;
+	} else {
+		std::copy(digits, digits + precision, rounded);
+		if(digits[precision] >= '5') {
+			int i = precision - 1;
+			for(; i >= 0  &&  rounded[i] == '9'; i--) {
+				rounded[i] = '0';
+			}
+			if(i >= 0) {
+				rounded[i]++;
+			} else {
+				rounded[0] = '1';
+				firstExponent++;
+			}
+		}
+	}
+	while(precision > 1  &&  rounded[precision - 1] == '0') {
+		precision--;
+	}
+	return precision;
+}
+
+// Writes the shortest digits of the double closest to x, if they read back as
+// x with strtold(), as the parser reads floats, and returns their end or null.
+// That is the case of the floats read from up to 17 digits.
+inline char* writeDoubleDigits(long double x, char* out) {
+	double d = static_cast<double>(x);
+	if(d == 0  ||  std::isinf(d)) {
+		return nullptr;
+	}
+	DecimalFloat decimal = shortestDecimal(d);
+	char* end = writeDecimal(decimal.digits, decimal.exponent, out);
+	*end = '\0';
+	return std::strtold(out, nullptr) == x ? end : nullptr;
+}
+
+// Writes x with the fewest significant digits that read back as x with
+// strtold(), and returns their end. Those of the closest double, from Ryu, are
+// tried first. Otherwise x is formatted once with more digits than long
+// doubles may need, and the fewest that read back once rounded are found by
+// bisection, since more digits never read back worse: the doubles that are not
+// short in long double, like 0.1, take up to 21.
+inline char* writeFloat(long double x, char* out) {
+	if(std::signbit(x)) {
+		*out++ = '-';
+		x = -x;
+	}
+	if(x == 0) {
+		return writeDecimal(0, 0, out);
+	}
+	char* end = writeDoubleDigits(x, out);
+	if(end) {
+		return end;
+	}
+
+	// With guard digits, so that rounding them again rounds as x would be
+	const int maxPrecision = std::numeric_limits<long double>::max_digits10;
+	const int guardedPrecision = maxPrecision + 20;
+	char text[guardedPrecision + 16];
+	std::snprintf(text, sizeof(text), "%.*Le", guardedPrecision - 1, x);
+	char digits[guardedPrecision];
+	int count = 0;
+	const char* p = text;
+	for(; *p != 'e'; p++) {
+		if(*p >= '0'  &&  *p <= '9') {
+			digits[count++] = *p;
+		}
+	}
+	int firstExponent = std::atoi(p + 1);
+
+	char rounded[maxPrecision];
+	int low = 1;
+	int high = maxPrecision;
+	while(low < high) {
+		int precision = (low + high) / 2;
+		int roundedFirstExponent = firstExponent;
+		int roundedCount = roundDigits(digits, count, precision, rounded, roundedFirstExponent);
+		end = writeDecimalDigits(rounded, roundedCount, roundedFirstExponent - roundedCount + 1, out);
+		*end = '\0';
+		if(std::strtold(out, nullptr) == x) {
+			high = precision;
+		} else {
+			low = precision + 1;
+		}
+	}
+	int roundedCount = roundDigits(digits, count, high, rounded, firstExponent);
+	return writeDecimalDigits(rounded, roundedCount, firstExponent - roundedCount + 1, out);
+}
+
+// The size of what writeFloat() writes
+inline size_t floatWidth(long double x) {
+	char buffer[floatSize];
+	return writeFloat(x, buffer) - buffer;
+}
+
+template <typename Sink>
 struct WriterVisitor : nosj::ConstVisitor {
-	std::ostream& os;
+	Sink& sink;
+	const bool asciiOnly;
 
-	WriterVisitor(std::ostream& os) : os(os) {}
+	WriterVisitor(Sink& sink, const StringifyOptions& options) : sink(sink), asciiOnly(options.asciiOnly) {}
 
-	void visit(const Null&)            override { os << "null"; }
+	void visit(const Null&)            override { sink.write("null", 4); }
 
-	void visit(const Boolean& boolean) override { os << (boolean ? "true" : "false"); }
+	void visit(const Boolean& boolean) override {
+		if(boolean) {
+			sink.write("true", 4);
+		} else {
+			sink.write("false", 5);
+		}
+	}
 
 	void visit(const Number& number)   override {
 		if(number.type() == Number::Type::IntegerNumber) {
-			os << number.integerRef();
+			sink.commit(writeInteger(number.integerRef(), sink.reserve(20)));
+		} else if(std::isfinite(number.floatRef())) {
+			sink.commit(writeFloat(number.floatRef(), sink.reserve(floatSize)));
 		} else {
-			std::ostringstream oss;
-			oss.precision(110);
-			oss.unsetf(oss.floatfield);
-			oss << number.floatRef();
-
-			const std::string& formatted = oss.str();
-			os << formatted;
-			if(formatted.find('.') == std::string::npos) {
-				os << ".0";
-			}
+			sink.write("null", 4); // JSON has no infinities nor NaN
 		}
 	}
 
 	void visit(const String& string) override {
-		os << '"';
-		for(unsigned char ch : string) {
+		sink.put('"');
+		const char* p = string.data();
+		const char* const end = p + string.size();
+		while(true) {
+			// The runs that need no escaping are copied as they are, or
+			// referenced by the sinks that can
+			const char* runEnd = findStringRunEnd(p, end, asciiOnly);
+			sink.writeLasting(p, runEnd - p);
+			if(runEnd == end) {
+				break;
+			}
+			p = runEnd;
+
+			unsigned char ch = *p;
+			if(ch >= 0x80) {
+				char32_t codePoint;
+				if(!decodeUTF8(p, end, codePoint)) {
+					codePoint = 0xFFFD;
+					p = end;
+				}
+				writeEscapedCodePoint(codePoint);
+				continue;
+			}
+
+			p++;
 			switch(ch) {
 			case '"':
 			case '\\':
-				os << '\\' << (char)ch;
+				sink.put('\\');
+				sink.put(ch);
 				break;
-			case '\x08': os << R"(\b)"; break;
-			case '\x0C': os << R"(\f)"; break;
-			case '\x0A': os << R"(\n)"; break;
-			case '\x0D': os << R"(\r)"; break;
-			case '\x09': os << R"(\t)"; break;
-			default:
-				if(ch < 0x20) {
-					writeEscapedChar(ch);
-				} else {
-					os << ch;
-				}
+			case '\x08': sink.write(R"(\b)", 2); break;
+			case '\x0C': sink.write(R"(\f)", 2); break;
+			case '\x0A': sink.write(R"(\n)", 2); break;
+			case '\x0D': sink.write(R"(\r)", 2); break;
+			case '\x09': sink.write(R"(\t)", 2); break;
+			default:      writeEscapedChar(ch);
 			}
 		}
-		os << '"';
+		sink.put('"');
 	}
 
 	void writeEscapedChar(unsigned ch) {
-		os << R"(\u)";
-		os.fill('0');
-		os.width(4);
-		os << std::hex << std::uppercase << (int)ch;
+		static const char hexDigits[] = "0123456789ABCDEF";
+		char* out = sink.reserve(6);
+		*out++ = '\\';
+		*out++ = 'u';
+		for(int shift = 12; shift >= 0; shift -= 4) {
+			*out++ = hexDigits[(ch >> shift) & 0xF];
+		}
+		sink.commit(out);
+	}
+
+	// As a surrogate pair beyond the Basic Multilingual Plane
+	void writeEscapedCodePoint(char32_t codePoint) {
+		if(codePoint >= 0x10000) {
+			codePoint -= 0x10000;
+			writeEscapedChar(0xD800 + (codePoint >> 10));
+			writeEscapedChar(0xDC00 + (codePoint & 0x3FF));
+		} else {
+			writeEscapedChar(codePoint);
+		}
 	}
 
 	void visit(const Array& array) override {
-		os << '[';
+		sink.put('[');
 		bool first = true;
 		for(auto& value : array) {
-			if(!first) {
-				os << ',';
-			}
-			value.accept(*this);
+			writeElement(value, first);
 			first = false;
 		}
-		os << ']';
+		sink.put(']');
 	}
 
 	void visit(const Object& object) override {
-		os << '{';
+		sink.put('{');
 		bool first = true;
 		for(auto& pair : object) {
-			const std::string& key = pair.first;
-			const Value& value = pair.second;
-			if(!first) {
-				os << ',';
-			}
-			visit(key);
-			os << ':';
-			value.accept(*this);
+			writeMember(pair.first, pair.second, first);
 			first = false;
 		}
-		os << '}';
+		sink.put('}');
+	}
+
+	void writeElement(const Value& value, bool first) {
+		if(!first) {
+			sink.put(',');
+		}
+		value.accept(*this);
+	}
+
+	void writeMember(const std::string& key, const Value& value, bool first) {
+		if(!first) {
+			sink.put(',');
+		}
+		visit(key);
+		sink.put(':');
+		value.accept(*this);
 	}
 };
 
-struct PrettyWriterVisitor : WriterVisitor {
+template <typename Sink>
+struct PrettyWriterVisitor : WriterVisitor<Sink> {
+	using WriterVisitor<Sink>::sink;
 
-	const std::string indentString;
+	const size_t indentWidth;
+	const char indentChar;
+	const std::string keySeparator;
+	const size_t inlineArraySize;
+	const size_t inlineObjectSize;
 	size_t indentLevel = 0;
 
-	void indent() {
-		for(size_t i = 0; i < indentLevel; i++) {
-			os << indentString;
+	// A line feed and the indentation of the deepest level so far, of which
+	// each line break writes a prefix
+	std::string lineBreak;
+
+	PrettyWriterVisitor(Sink& sink, const StringifyOptions& options)
+		: WriterVisitor<Sink>(sink, options), indentWidth(options.indentWidth), indentChar(options.indentChar),
+		  keySeparator(options.keySeparator), inlineArraySize(options.inlineArraySize),
+		  inlineObjectSize(options.inlineObjectSize), lineBreak("\n") {}
+
+	void writeLineBreak() {
+		size_t size = 1 + indentLevel * indentWidth;
+		if(lineBreak.size() < size) {
+			lineBreak.resize(2 * size, indentChar);
 		}
+		sink.write(lineBreak.data(), size);
 	}
 
-	PrettyWriterVisitor(std::ostream& os) : WriterVisitor(os), indentString("   ") {}
-
 	void visit(const Array& array) override {
-		if(array.size() <= 1) {
-			WriterVisitor::visit(array);
+		if(array.size() <= inlineArraySize) {
+			WriterVisitor<Sink>::visit(array);
 		} else {
-			os << '[';
+			sink.put('[');
 
 			indentLevel++;
 			bool first = true;
 			for(auto& value : array) {
-				if(!first) {
-					os << ',';
-				}
-
-				os << std::endl;
-				indent();
-				value.accept(*this);
+				writeElement(value, first);
 				first = false;
 			}
-			os << std::endl;
 			indentLevel--;
-			indent();
-			os << ']';
+			writeLineBreak();
+			sink.put(']');
 		}
 	}
 
 	void visit(const Object& object) override {
-		if(object.empty()) {
-			WriterVisitor::visit(object);
+		if(object.size() <= inlineObjectSize) {
+			WriterVisitor<Sink>::visit(object);
 		} else {
-			os << '{';
+			sink.put('{');
 
 			indentLevel++;
 			bool first = true;
 			for(auto& pair : object) {
-				const std::string& key = pair.first;
-				const Value& value = pair.second;
-				if(!first) {
-					os << ',';
+				writeMember(pair.first, pair.second, first);
+				first = false;
+			}
+			indentLevel--;
+			writeLineBreak();
+			sink.put('}');
+		}
+	}
+
+	// On lines of their own, one level deeper than the container
+	void writeElement(const Value& value, bool first) {
+		if(!first) {
+			sink.put(',');
+		}
+		writeLineBreak();
+		value.accept(*this);
+	}
+
+	void writeMember(const std::string& key, const Value& value, bool first) {
+		if(!first) {
+			sink.put(',');
+		}
+		writeLineBreak();
+		WriterVisitor<Sink>::visit(key);
+		sink.write(keySeparator.data(), keySeparator.size());
+		value.accept(*this);
+	}
+};
+
+template <typename Sink>
+void writeValue(Sink& sink, const Value& value, const StringifyOptions& options) {
+	if(options.pretty) {
+		PrettyWriterVisitor<Sink> visitor(sink, options);
+		value.accept(visitor);
+	} else {
+		WriterVisitor<Sink> visitor(sink, options);
+		value.accept(visitor);
+	}
+}
+
+// Counts the output of the visitor, with the width of numbers instead of their
+// digits
+template <typename Visitor>
+struct SizingVisitor : Visitor {
+	using Visitor::visit;
+
+	SizingVisitor(CountingSink& sink, const StringifyOptions& options) : Visitor(sink, options) {}
+
+	void visit(const Number& number) override {
+		if(number.type() == Number::Type::IntegerNumber) {
+			long long n = number.integerRef();
+			this->sink.skip((n < 0) + countDigits(n < 0 ? 0 - static_cast<unsigned long long>(n) : n));
+		} else if(std::isfinite(number.floatRef())) {
+			this->sink.skip(floatWidth(number.floatRef()));
+		} else {
+			this->sink.skip(4);
+		}
+	}
+};
+
+inline size_t sizeValue(const Value& value, const StringifyOptions& options) {
+	CountingSink sink;
+	if(options.pretty) {
+		SizingVisitor<PrettyWriterVisitor<CountingSink>> visitor(sink, options);
+		value.accept(visitor);
+	} else {
+		SizingVisitor<WriterVisitor<CountingSink>> visitor(sink, options);
+		value.accept(visitor);
+	}
+	return sink.size();
+}
+
+inline StringifyOptions prettyOptions(bool pretty) {
+	StringifyOptions options;
+	options.pretty = pretty;
+	return options;
+}
+
+// The containers with at least this many elements or members are split in
+// chunks by stringifyParallel()
+enum { parallelSplitSize = 1024, minParallelChunkSize = 256 };
+
+// How each visitor writes around the elements and members of a container that
+// is written by parts, split or cached, which must be what its own visit()
+// writes
+template <typename Sink>
+bool isSplittable(const WriterVisitor<Sink>&, size_t, bool) {
+	return true;
+}
+
+template <typename Sink>
+bool isSplittable(const PrettyWriterVisitor<Sink>& visitor, size_t size, bool object) {
+	return size > (object ? visitor.inlineObjectSize : visitor.inlineArraySize);
+}
+
+template <typename Sink>
+void openSplit(WriterVisitor<Sink>& visitor, char bracket) {
+	visitor.sink.put(bracket);
+}
+
+template <typename Sink>
+void openSplit(PrettyWriterVisitor<Sink>& visitor, char bracket) {
+	visitor.sink.put(bracket);
+	visitor.indentLevel++;
+}
+
+template <typename Sink>
+void closeSplit(WriterVisitor<Sink>& visitor, char bracket) {
+	visitor.sink.put(bracket);
+}
+
+template <typename Sink>
+void closeSplit(PrettyWriterVisitor<Sink>& visitor, char bracket) {
+	visitor.indentLevel--;
+	visitor.writeLineBreak();
+	visitor.sink.put(bracket);
+}
+
+template <typename Sink>
+size_t indentLevelOf(const WriterVisitor<Sink>&) {
+	return 0;
+}
+
+template <typename Sink>
+size_t indentLevelOf(const PrettyWriterVisitor<Sink>& visitor) {
+	return visitor.indentLevel;
+}
+
+template <typename Sink>
+void setIndentLevel(WriterVisitor<Sink>&, size_t) {}
+
+template <typename Sink>
+void setIndentLevel(PrettyWriterVisitor<Sink>& visitor, size_t indentLevel) {
+	visitor.indentLevel = indentLevel;
+}
+
+// Writes the value but the elements and members of its large containers, of
+// which it records the chunks, and where their output goes in its own
+template <typename Visitor>
+struct ParallelWriterVisitor : Visitor {
+	using Member = Object::value_type;
+
+	struct Chunk {
+		const Array* array;            // Or else:
+		const Member* const* members;
+		size_t first;
+		size_t last;
+		size_t indentLevel;
+		size_t offset;                 // In the output of the visitor
+		std::string output;
+	};
+
+	const size_t maxChunkCount; // Per container
+	std::vector<Chunk> chunks;
+	std::deque<std::vector<const Member*>> memberLists;
+
+	ParallelWriterVisitor(StringSink& sink, const StringifyOptions& options, unsigned int threadCount)
+		: Visitor(sink, options), maxChunkCount(size_t(threadCount) * 8) {}
+
+	void visit(const Array& array) override {
+		if(array.size() < parallelSplitSize  ||  !isSplittable(*this, array.size(), false)) {
+			Visitor::visit(array);
+		} else {
+			openSplit(*this, '[');
+			addChunks(&array, nullptr, array.size());
+			closeSplit(*this, ']');
+		}
+	}
+
+	void visit(const Object& object) override {
+		if(object.size() < parallelSplitSize  ||  !isSplittable(*this, object.size(), true)) {
+			Visitor::visit(object);
+		} else {
+			// In the order of the serial writer
+			memberLists.emplace_back();
+			std::vector<const Member*>& members = memberLists.back();
+			members.reserve(object.size());
+			for(auto& member : object) {
+				members.push_back(&member);
+			}
+
+			openSplit(*this, '{');
+			addChunks(nullptr, members.data(), members.size());
+			closeSplit(*this, '}');
+		}
+	}
+
+	void addChunks(const Array* array, const Member* const* members, size_t size) {
+		size_t offset = this->sink.size();
+		size_t chunkSize = std::max<size_t>((size + maxChunkCount - 1) / maxChunkCount, minParallelChunkSize);
+		for(size_t first = 0; first < size; first += chunkSize) {
+			size_t last = std::min(first + chunkSize, size);
+			chunks.push_back(Chunk{array, members, first, last, indentLevelOf(*this), offset, std::string()});
+		}
+	}
+
+	static void writeChunk(Chunk& chunk, const StringifyOptions& options) {
+		StringSink sink(chunk.output);
+		Visitor visitor(sink, options);
+		setIndentLevel(visitor, chunk.indentLevel);
+		for(size_t i = chunk.first; i < chunk.last; i++) {
+			if(chunk.array) {
+				visitor.writeElement((*chunk.array)[i], i == 0);
+			} else {
+				visitor.writeMember(chunk.members[i]->first, chunk.members[i]->second, i == 0);
+			}
+		}
+		sink.flush();
+	}
+};
+
+template <typename Visitor>
+std::string writeParallel(const Value& value, unsigned int threadCount, const StringifyOptions& options) {
+	std::string structure;
+	StringSink sink(structure);
+	ParallelWriterVisitor<Visitor> visitor(sink, options, threadCount);
+	value.accept(visitor);
+	sink.flush();
+
+	auto& chunks = visitor.chunks;
+	if(chunks.empty()) {
+		return structure;
+	}
+	parallelFor(chunks.size(), threadCount, [&](size_t i) {
+		ParallelWriterVisitor<Visitor>::writeChunk(chunks[i], options);
+	});
+
+	// The chunks go in order, each at its place in the structure
+	size_t size = structure.size();
+	for(auto& chunk : chunks) {
+		size += chunk.output.size();
+	}
+	std::string output;
+	output.reserve(size);
+	size_t position = 0;
+	for(auto& chunk : chunks) {
+		output.append(structure, position, chunk.offset - position);
+		output += chunk.output;
+		position = chunk.offset;
+	}
+	output.append(structure, position, std::string::npos);
+	return output;
+}
+
+// The options that the output depends on, which a StringifyCache keeps
+inline std::string layoutOf(const StringifyOptions& options) {
+	std::string layout;
+	layout += options.pretty ? 'p' : 'c';
+	layout += options.asciiOnly ? 'a' : 'u';
+	layout += options.indentChar;
+	for(size_t n : {options.indentWidth, options.inlineArraySize, options.inlineObjectSize}) {
+		layout += std::to_string(n);
+		layout += ',';
+	}
+	layout += options.keySeparator;
+	return layout;
+}
+
+// Drops what the cache keeps of the container and of all that it holds
+inline void dropContainer(std::unordered_map<const Value*, SerializedContainer>& containers, const Value* value) {
+	auto found = containers.find(value);
+	if(found == containers.end()) {
+		return;
+	}
+	std::vector<const Value*> nested = std::move(found->second.containers);
+	containers.erase(found);
+	for(const Value* nestedValue : nested) {
+		// Unless it was written elsewhere since
+		auto nestedFound = containers.find(nestedValue);
+		if(nestedFound != containers.end()  &&  nestedFound->second.parent == value) {
+			dropContainer(containers, nestedValue);
+		}
+	}
+}
+
+// Copies the arrays and objects of the document from the cache, or else writes
+// them and keeps their output, which the string holds until the end
+template <typename Visitor>
+struct CachingWriterVisitor : Visitor {
+	std::unordered_map<const Value*, SerializedContainer>& containers;
+	std::string& output;
+	const Value* next = nullptr;                        // The value of which the container is visited next
+	std::vector<const Value*> parents;                  // Of the containers being written
+	std::vector<std::vector<const Value*>> nestedLists; // The containers written right in them
+
+	CachingWriterVisitor(StringSink& sink, std::string& output, const StringifyOptions& options,
+	                     std::unordered_map<const Value*, SerializedContainer>& containers)
+		: Visitor(sink, options), containers(containers), output(output) {}
+
+	void visit(const Array& array) override {
+		const Value* value = takeNext();
+		if(value  &&  (!value->isArray()  ||  &value->asArray() != &array)) {
+			value = nullptr;
+		}
+		writeCached(value, [&]() {
+			bool split = isSplittable(*this, array.size(), false);
+			if(split) {
+				openSplit(*this, '[');
+			} else {
+				this->sink.put('[');
+			}
+			bool first = true;
+			for(auto& element : array) {
+				next = &element;
+				if(split) {
+					Visitor::writeElement(element, first);
+				} else {
+					WriterVisitor<StringSink>::writeElement(element, first);
 				}
+				next = nullptr;
+				first = false;
+			}
+			if(split) {
+				closeSplit(*this, ']');
+			} else {
+				this->sink.put(']');
+			}
+		});
+	}
 
-				os << std::endl;
-				indent();
-				WriterVisitor::visit(key);
-				os << " : ";
-				value.accept(*this);
+	void visit(const Object& object) override {
+		const Value* value = takeNext();
+		if(value  &&  (!value->isObject()  ||  &value->asObject() != &object)) {
+			value = nullptr;
+		}
+		writeCached(value, [&]() {
+			bool split = isSplittable(*this, object.size(), true);
+			if(split) {
+				openSplit(*this, '{');
+			} else {
+				this->sink.put('{');
+			}
+			bool first = true;
+			for(auto& member : object) {
+				next = &member.second;
+				if(split) {
+					Visitor::writeMember(member.first, member.second, first);
+				} else {
+					WriterVisitor<StringSink>::writeMember(member.first, member.second, first);
+				}
+				next = nullptr;
 				first = false;
 			}
-			os << std::endl;
-			indentLevel--;
-			indent();
-			os << '}';
+			if(split) {
+				closeSplit(*this, '}');
+			} else {
+				this->sink.put('}');
+			}
+		});
+	}
+
+	const Value* takeNext() {
+		const Value* value = next;
+		next = nullptr;
+		return value;
+	}
+
+	template <typename Write>
+	void writeCached(const Value* value, Write write) {
+		if(!value) {
+			write();
+			return;
+		}
+
+		const Value* parent = parents.empty() ? nullptr : parents.back();
+		size_t indentLevel = indentLevelOf(*this);
+		auto found = containers.find(value);
+		if(found != containers.end()) {
+			SerializedContainer& container = found->second;
+			if(container.parent == parent  &&  container.indentLevel == indentLevel  &&  container.kept) {
+				this->sink.write(container.output.data(), container.output.size());
+				addNested(value);
+				return;
+			}
+			// Of another place in the document: nothing of it may be kept
+			if(container.parent != parent  ||  container.indentLevel != indentLevel) {
+				dropContainer(containers, value);
+			}
+		}
+
+		size_t start = this->sink.size();
+		parents.push_back(value);
+		nestedLists.emplace_back();
+		write();
+		SerializedContainer& container = containers[value];
+		container.parent = parent;
+		container.containers = std::move(nestedLists.back());
+		container.indentLevel = indentLevel;
+		container.kept = true;
+		container.output.assign(&output[start], this->sink.size() - start);
+		nestedLists.pop_back();
+		parents.pop_back();
+		addNested(value);
+	}
+
+	void addNested(const Value* value) {
+		if(!nestedLists.empty()) {
+			nestedLists.back().push_back(value);
+		}
+	}
+};
+
+template <typename Visitor>
+std::string writeCached(const Value& value, const StringifyOptions& options,
+                        std::unordered_map<const Value*, SerializedContainer>& containers) {
+	std::string output;
+	StringSink sink(output);
+	CachingWriterVisitor<Visitor> visitor(sink, output, options, containers);
+	visitor.next = &value;
+	value.accept(visitor);
+	sink.flush();
+	return output;
+}
+
+template <typename Char>
+void appendEncoded(std::basic_string<Char>& output, const char* bytes, size_t size) {
+	size_t length = output.size();
+	output.resize(length + size / sizeof(Char));
+	std::memcpy(&output[length], bytes, size);
+}
+
+inline void appendEncoded(std::ostream& os, const char* bytes, size_t size) {
+	os.write(bytes, size);
+}
+
+// Takes the UTF-8 text from the writers and appends it to the output in the
+// encoding of the code units, a buffer at a time. The runs of ASCII, which make
+// most of the text, are widened a block at a time. finish() encodes what is
+// left, including a UTF-8 sequence cut short, which every earlier conversion
+// keeps for later.
+template <typename Units, typename Output>
+class EncodingSink : public BasicSink<EncodingSink<Units, Output>> {
+public:
+	EncodingSink(Output& output) : output(output) {
+		this->current = buffer;
+		this->end = buffer + bufferSize;
+	}
+
+	void finish() {
+		encode(true);
+	}
+
+private:
+	enum { bufferSize = 4096, blockSize = 16 };
+
+	Output& output;
+	char buffer[bufferSize];
+	char encoded[bufferSize * 4]; // A byte of UTF-8 is at most a UTF-32 code unit
+
+	void makeRoom(size_t) {
+		encode(false);
+	}
+
+	void encode(bool final) {
+		const char* p = buffer;
+		const char* const end = this->current;
+		char* out = encoded;
+		bool cutShort = false;
+		while(p != end  &&  !cutShort) {
+#ifdef __SSE2__
+			if(end - p >= blockSize  &&  Units::widenASCII(p, out)) {
+				p += blockSize;
+				out += blockSize * Units::size;
+				continue;
+			}
+#endif
+			const char* blockEnd = p + std::min<ptrdiff_t>(blockSize, end - p);
+			while(p < blockEnd) {
+				char32_t ch;
+				if(!decodeUTF8(p, end, ch)) {
+					if(!final) {
+						cutShort = true;
+						break;
+					}
+					ch = 0xFFFD;
+					p = end;
+				}
+				out = Units::encode(ch, out);
+			}
 		}
+		appendEncoded(output, encoded, out - encoded);
 
+		size_t rest = end - p;
+		std::memmove(buffer, p, rest);
+		this->current = buffer + rest;
 	}
 
+	friend class BasicSink<EncodingSink>;
 };
 
+template <typename Units, typename Output>
+void writeTranscoded(Output& output, const Value& value, bool pretty) {
+	EncodingSink<Units, Output> sink(output);
+	writeValue(sink, value, prettyOptions(pretty));
+	sink.finish();
+}
+
+template <typename Output>
+void writeEncoded(Output& output, const Value& value, Encoding encoding, bool pretty) {
+	switch(encoding) {
+	case Encoding::UTF16BE: writeTranscoded<UTF16Units<true>> (output, value, pretty); break;
+	case Encoding::UTF16LE: writeTranscoded<UTF16Units<false>>(output, value, pretty); break;
+	case Encoding::UTF32BE: writeTranscoded<UTF32Units<true>> (output, value, pretty); break;
+	case Encoding::UTF32LE: writeTranscoded<UTF32Units<false>>(output, value, pretty); break;
+	case Encoding::UTF8:    break; // Written as it is by the callers
+	}
+}
+
 }
 
 
@@ -190,18 +927,133 @@ inline std::ostream& operator<<(std::ostream& os, const Value& value) {
 }
 
 inline std::string stringify(const Value& value, bool pretty) {
-	std::ostringstream os;
-	writeTo(os, value, pretty);
-	return os.str();
+	return stringify(value, _details::prettyOptions(pretty));
+}
+
+// In one pass: sizing first walks the value twice, which costs more than the
+// string growing
+inline std::string stringify(const Value& value, const StringifyOptions& options) {
+	std::string output;
+	StringSink sink(output);
+	_details::writeValue(sink, value, options);
+	sink.flush();
+	return output;
+}
+
+inline std::string stringifyParallel(const Value& value, unsigned int threadCount, const StringifyOptions& options) {
+	if(threadCount == 0) {
+		threadCount = _details::defaultThreadCount();
+	}
+	if(threadCount == 1) {
+		return stringify(value, options);
+	} else if(options.pretty) {
+		return _details::writeParallel<_details::PrettyWriterVisitor<StringSink>>(value, threadCount, options);
+	} else {
+		return _details::writeParallel<_details::WriterVisitor<StringSink>>(value, threadCount, options);
+	}
+}
+
+inline size_t serializedSize(const Value& value, bool pretty) {
+	return serializedSize(value, _details::prettyOptions(pretty));
+}
+
+inline size_t serializedSize(const Value& value, const StringifyOptions& options) {
+	return _details::sizeValue(value, options);
+}
+
+inline std::string StringifyCache::stringify(const Value& value) {
+	std::string newLayout = _details::layoutOf(options);
+	if(newLayout != layout) {
+		containers.clear();
+		layout = std::move(newLayout);
+	}
+	if(options.pretty) {
+		return _details::writeCached<_details::PrettyWriterVisitor<StringSink>>(value, options, containers);
+	}
+	return _details::writeCached<_details::WriterVisitor<StringSink>>(value, options, containers);
+}
+
+inline void StringifyCache::invalidate(const Value& value) {
+	auto found = containers.find(&value);
+	if(found == containers.end()) {
+		containers.clear();
+		return;
+	}
+	const Value* parent = found->second.parent;
+	_details::dropContainer(containers, &value);
+	// The containers above keep the list of those in them, to drop them later
+	while(parent) {
+		found = containers.find(parent);
+		if(found == containers.end()) {
+			break;
+		}
+		found->second.kept = false;
+		std::string().swap(found->second.output);
+		parent = found->second.parent;
+	}
+}
+
+inline void StringifyCache::clear() {
+	containers.clear();
+}
+
+inline size_t stringifyTo(char* buffer, size_t capacity, const Value& value, bool pretty) {
+	return stringifyTo(buffer, capacity, value, _details::prettyOptions(pretty));
+}
+
+inline size_t stringifyTo(char* buffer, size_t capacity, const Value& value, const StringifyOptions& options) {
+	FixedBufferSink sink(buffer, capacity);
+	_details::writeValue(sink, value, options);
+	sink.flush();
+	return sink.size();
 }
 
 inline void writeTo(std::ostream& os, const Value& value, bool pretty) {
-	if(pretty) {
-		_details::PrettyWriterVisitor visitor(os);
-		value.accept(visitor);
+	writeTo(os, value, _details::prettyOptions(pretty));
+}
+
+inline void writeTo(std::ostream& os, const Value& value, const StringifyOptions& options) {
+	StreamSink sink(os);
+	_details::writeValue(sink, value, options);
+	sink.flush();
+}
+
+template <typename Sink>
+void writeTo(BasicSink<Sink>& sink, const Value& value, bool pretty) {
+	writeTo(sink, value, _details::prettyOptions(pretty));
+}
+
+template <typename Sink>
+void writeTo(BasicSink<Sink>& sink, const Value& value, const StringifyOptions& options) {
+	_details::writeValue(static_cast<Sink&>(sink), value, options);
+}
+
+inline std::string stringify(const Value& value, Encoding encoding, bool pretty) {
+	if(encoding == Encoding::UTF8) {
+		return stringify(value, pretty);
+	}
+	std::string output;
+	_details::writeEncoded(output, value, encoding, pretty);
+	return output;
+}
+
+inline std::u16string stringifyUTF16(const Value& value, bool pretty) {
+	std::u16string output;
+	_details::writeEncoded(output, value, _details::nativeUTF16, pretty);
+	return output;
+}
+
+inline std::u32string stringifyUTF32(const Value& value, bool pretty) {
+	std::u32string output;
+	_details::writeEncoded(output, value, _details::nativeUTF32, pretty);
+	return output;
+}
+
+inline void writeTo(std::ostream& os, const Value& value, Encoding encoding, bool pretty) {
+	if(encoding == Encoding::UTF8) {
+		writeTo(os, value, pretty);
 	} else {
-		_details::WriterVisitor visitor(os);
-		value.accept(visitor);
+		_details::writeEncoded(os, value, encoding, pretty);
 	}
 }
 
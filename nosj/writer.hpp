@@ -0,0 +1,109 @@
+#ifndef WRITER_HPP_
+#define WRITER_HPP_
+
+
+#include "sink.hpp"
+#include "stringify.hpp"
+#include "values.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace nosj {
+
+
+namespace _details {
+	template <typename Sink> class WriterBuffer;
+}
+
+// Writes a JSON text piece by piece to a sink, without building the values.
+// The output is the same as the one of stringify() for the same values, pretty
+// or not. Misplaced calls, like a key outside of an object or an end without
+// a beginning, fail an assert(), so they are only checked in debug builds.
+// flush() passes what is written on to the sink, which the caller flushes in
+// turn.
+template <typename Sink>
+class Writer {
+public:
+	explicit Writer(Sink& sink, const StringifyOptions& = StringifyOptions());
+	~Writer();
+
+	Writer(const Writer&) = delete;
+	Writer& operator=(const Writer&) = delete;
+
+	Writer& beginObject();
+	Writer& endObject();
+	Writer& beginArray();
+	Writer& endArray();
+
+	// A member of an object, whose value comes next
+	Writer& key(const String&);
+	Writer& key(const char*);
+
+	Writer& null();
+	Writer& value(bool);
+	Writer& value(const char*);
+	Writer& value(const String&);
+	Writer& value(const Value&);
+
+	template <typename Integer>
+	typename std::enable_if<std::is_integral<Integer>::value, Writer&>::type value(Integer);
+	template <typename Float>
+	typename std::enable_if<std::is_floating_point<Float>::value, Writer&>::type value(Float);
+
+	// Whether a whole value was written
+	bool complete() const { return completed; }
+
+	void flush();
+
+private:
+	struct Container {
+		bool object;
+		size_t count = 0;            // Of the elements or members so far
+		bool expectingValue = false; // After a key
+		// Of its members on lines, as if the containers that hold above it were
+		// on one line
+		size_t indentLevel = 0;
+		// While it is unknown whether a pretty container stays on one line,
+		// where its members and the ':' after their keys are in the held output
+		bool holding = false;
+		std::vector<size_t> starts;
+		std::vector<size_t> separators;
+
+		Container(bool object) : object(object) {}
+	};
+
+	using Buffer = _details::WriterBuffer<Sink>;
+
+	std::unique_ptr<Buffer> buffer;
+	const StringifyOptions options;
+	_details::WriterVisitor<Buffer> compactVisitor;
+	_details::PrettyWriterVisitor<Buffer> prettyVisitor;
+	std::vector<Container> containers;
+	bool completed = false;
+
+	void beforeValue();
+	void afterValue();
+	void beginContainer(bool object, char bracket);
+	void endContainer(char bracket);
+	void beginMember(Container&);
+	void writeLineBreak(size_t indentLevel);
+	size_t valueIndentLevel() const;
+	void layOnLines(Container&);
+	void appendIndented(std::string& output, size_t start, size_t end);
+	void stopHolding(Container&);
+	template <typename Scalar>
+	Writer& writeScalar(const Scalar&);
+};
+
+
+}
+
+
+#include "writer.inl"
+
+
+#endif /* WRITER_HPP_ */
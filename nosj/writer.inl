@@ -0,0 +1,326 @@
+#include <cassert>
+#include <memory>
+#include <string>
+
+
+namespace nosj {
+
+
+namespace _details {
+
+// Buffers the output of a Writer, and passes it on to the sink a buffer at a
+// time, unless it holds it back: a pretty container is written on one line if
+// it is small enough, so its first members are held back until the next member
+// or its end tells how to lay it out. The members are held as on one line, so
+// the lines of containers in them only get a level of indentation more when
+// the container turns out to be on lines.
+template <typename Sink>
+class WriterBuffer : public BasicSink<WriterBuffer<Sink>> {
+public:
+	std::string held;
+	size_t holdingCount = 0; // The arrays that hold back the output
+
+	explicit WriterBuffer(Sink& sink) : sink(sink) {
+		this->current = buffer;
+		this->end = buffer + bufferSize;
+	}
+
+	// Moves the buffer to the held output, or passes them on to the sink
+	void drain() {
+		if(holdingCount > 0) {
+			held.append(buffer, this->current - buffer);
+		} else {
+			if(!held.empty()) {
+				sink.write(held.data(), held.size());
+				held.clear();
+			}
+			sink.write(buffer, this->current - buffer);
+		}
+		this->current = buffer;
+	}
+
+private:
+	enum { bufferSize = 4096 };
+
+	Sink& sink;
+	char buffer[bufferSize];
+
+	void makeRoom(size_t) {
+		drain();
+	}
+
+	friend class BasicSink<WriterBuffer>;
+};
+
+}
+
+
+template <typename Sink>
+Writer<Sink>::Writer(Sink& sink, const StringifyOptions& options)
+	: buffer(new Buffer(sink)), options(options), compactVisitor(*buffer, options), prettyVisitor(*buffer, options) {}
+
+template <typename Sink>
+Writer<Sink>::~Writer() {
+	try {
+		flush();
+	} catch(...) {
+	}
+}
+
+template <typename Sink>
+void Writer<Sink>::flush() {
+	buffer->drain();
+}
+
+template <typename Sink>
+void Writer<Sink>::writeLineBreak(size_t indentLevel) {
+	prettyVisitor.indentLevel = indentLevel;
+	prettyVisitor.writeLineBreak();
+}
+
+template <typename Sink>
+void Writer<Sink>::beforeValue() {
+	if(containers.empty()) {
+		assert(!completed  &&  "nosj::Writer: more than one value at the top level");
+		return;
+	}
+
+	Container& container = containers.back();
+	if(container.object) {
+		assert(container.expectingValue  &&  "nosj::Writer: a member without a key");
+		container.expectingValue = false;
+	} else {
+		beginMember(container);
+	}
+}
+
+template <typename Sink>
+void Writer<Sink>::afterValue() {
+	if(containers.empty()) {
+		completed = true;
+	}
+}
+
+template <typename Sink>
+void Writer<Sink>::beginMember(Container& container) {
+	size_t inlineSize = container.object ? options.inlineObjectSize : options.inlineArraySize;
+	if(container.holding  &&  container.count == inlineSize) {
+		layOnLines(container); // One member too many for a line
+	}
+
+	if(container.count > 0) {
+		buffer->put(',');
+	}
+	if(container.holding) {
+		buffer->drain();
+		container.starts.push_back(buffer->held.size());
+	} else if(options.pretty) {
+		writeLineBreak(container.indentLevel);
+	}
+	container.count++;
+}
+
+// Where the lines of the next value start, as long as the containers that hold
+// stay on one line
+template <typename Sink>
+size_t Writer<Sink>::valueIndentLevel() const {
+	if(containers.empty()) {
+		return 0;
+	}
+	const Container& container = containers.back();
+	return container.holding ? container.indentLevel - 1 : container.indentLevel;
+}
+
+// The held members were written as on one line: each gets a line of its own,
+// and the lines in them a level of indentation more
+template <typename Sink>
+void Writer<Sink>::layOnLines(Container& container) {
+	buffer->drain();
+	std::string& held = buffer->held;
+	std::string lineBreak = '\n' + std::string(container.indentLevel * options.indentWidth, options.indentChar);
+	std::string laidOut;
+	laidOut.reserve(held.size() - container.starts[0] + container.count * (lineBreak.size() + options.keySeparator.size()));
+	for(size_t i = 0; i < container.count; i++) {
+		size_t end = i + 1 < container.count ? container.starts[i + 1] : held.size();
+		laidOut += lineBreak;
+		if(container.object) {
+			laidOut.append(held, container.starts[i], container.separators[i] - container.starts[i]);
+			laidOut += options.keySeparator;
+			appendIndented(laidOut, container.separators[i] + 1, end);
+		} else {
+			appendIndented(laidOut, container.starts[i], end);
+		}
+	}
+	held.resize(container.starts[0]);
+	held += laidOut;
+	stopHolding(container);
+}
+
+// Pretty output escapes the line breaks in strings, so those in the held output
+// are all between lines
+template <typename Sink>
+void Writer<Sink>::appendIndented(std::string& output, size_t start, size_t end) {
+	const std::string& held = buffer->held;
+	for(size_t lineBreak = held.find('\n', start); lineBreak < end; lineBreak = held.find('\n', start)) {
+		output.append(held, start, lineBreak + 1 - start);
+		output.append(options.indentWidth, options.indentChar);
+		start = lineBreak + 1;
+	}
+	output.append(held, start, end - start);
+}
+
+template <typename Sink>
+void Writer<Sink>::stopHolding(Container& container) {
+	container.holding = false;
+	container.starts.clear();
+	container.separators.clear();
+	buffer->holdingCount--;
+}
+
+template <typename Sink>
+void Writer<Sink>::beginContainer(bool object, char bracket) {
+	beforeValue();
+	buffer->put(bracket);
+
+	Container container(object);
+	container.indentLevel = valueIndentLevel() + 1;
+	size_t inlineSize = object ? options.inlineObjectSize : options.inlineArraySize;
+	if(options.pretty  &&  inlineSize > 0) {
+		buffer->drain();
+		buffer->holdingCount++;
+		container.holding = true;
+	}
+	containers.push_back(std::move(container));
+}
+
+template <typename Sink>
+void Writer<Sink>::endContainer(char bracket) {
+	Container& container = containers.back();
+	if(container.holding) {
+		// Small enough for a line, as held
+		stopHolding(container);
+	} else if(options.pretty  &&  container.count > 0) {
+		writeLineBreak(container.indentLevel - 1);
+	}
+	containers.pop_back();
+	buffer->put(bracket);
+	afterValue();
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::beginObject() {
+	beginContainer(true, '{');
+	return *this;
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::endObject() {
+	assert(!containers.empty()  &&  containers.back().object  &&  "nosj::Writer: no object to end");
+	assert(!containers.back().expectingValue  &&  "nosj::Writer: a key without a value");
+	endContainer('}');
+	return *this;
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::beginArray() {
+	beginContainer(false, '[');
+	return *this;
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::endArray() {
+	assert(!containers.empty()  &&  !containers.back().object  &&  "nosj::Writer: no array to end");
+	endContainer(']');
+	return *this;
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::key(const String& key) {
+	assert(!containers.empty()  &&  containers.back().object  &&  "nosj::Writer: a key outside of an object");
+	assert(!containers.back().expectingValue  &&  "nosj::Writer: a key without a value");
+
+	Container& container = containers.back();
+	beginMember(container);
+	compactVisitor.visit(key);
+	if(container.holding) {
+		buffer->drain();
+		container.separators.push_back(buffer->held.size());
+		buffer->put(':');
+	} else if(options.pretty) {
+		buffer->write(options.keySeparator.data(), options.keySeparator.size());
+	} else {
+		buffer->put(':');
+	}
+	container.expectingValue = true;
+	return *this;
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::key(const char* key) {
+	return this->key(String(key));
+}
+
+template <typename Sink>
+template <typename Scalar>
+Writer<Sink>& Writer<Sink>::writeScalar(const Scalar& scalar) {
+	beforeValue();
+	compactVisitor.visit(scalar);
+	afterValue();
+	return *this;
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::null() {
+	return writeScalar(nosj::null);
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::value(bool boolean) {
+	return writeScalar(boolean);
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::value(const char* string) {
+	return writeScalar(String(string));
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::value(const String& string) {
+	return writeScalar(string);
+}
+
+template <typename Sink>
+Writer<Sink>& Writer<Sink>::value(const Value& value) {
+	beforeValue();
+	if(options.pretty) {
+		prettyVisitor.indentLevel = valueIndentLevel();
+		value.accept(prettyVisitor);
+	} else {
+		value.accept(compactVisitor);
+	}
+	afterValue();
+	return *this;
+}
+
+template <typename Sink>
+template <typename Integer>
+typename std::enable_if<std::is_integral<Integer>::value, Writer<Sink>&>::type Writer<Sink>::value(Integer n) {
+	beforeValue();
+	char* out = buffer->reserve(21);
+	if(std::is_signed<Integer>::value) {
+		buffer->commit(_details::writeInteger(static_cast<long long>(n), out));
+	} else {
+		buffer->commit(_details::writeUnsigned(static_cast<unsigned long long>(n), out));
+	}
+	afterValue();
+	return *this;
+}
+
+template <typename Sink>
+template <typename Float>
+typename std::enable_if<std::is_floating_point<Float>::value, Writer<Sink>&>::type Writer<Sink>::value(Float x) {
+	return writeScalar(Number(static_cast<Number::Float>(x)));
+}
+
+
+}
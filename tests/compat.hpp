@@ -24,6 +24,9 @@ void setMemoryLimit(unsigned long) {}
 # include <cassert>
 # include <sys/resource.h>
 # include <sys/time.h>
+# ifdef __GLIBC__
+#  include <malloc.h>
+# endif
 
 namespace /*unnamed*/ {
 
@@ -31,6 +34,10 @@ void setMemoryLimit(unsigned long mem) {
 	struct rlimit rlim;
 	rlim.rlim_cur = rlim.rlim_max = mem;
 	assert(setrlimit(RLIMIT_AS, &rlim) == 0);
+# ifdef __GLIBC__
+	// The arena of each thread reserves 64 MB of the address space
+	mallopt(M_ARENA_MAX, 1);
+# endif
 }
 
 }
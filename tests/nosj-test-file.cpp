@@ -0,0 +1,142 @@
+#include "nosj-test.hpp"
+#include "nosj/file.hpp"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+
+namespace /*unnamed*/ {
+
+struct TemporaryFile {
+	std::string path;
+
+	TemporaryFile(const std::string& contents) {
+		char name[] = "/tmp/nosj-test-XXXXXX";
+		int fd = mkstemp(name);
+		assert(fd >= 0);
+		close(fd);
+		path = name;
+
+		std::ofstream os(path, std::ios::binary);
+		os << contents;
+	}
+
+	~TemporaryFile() {
+		std::remove(path.c_str());
+	}
+};
+
+void test_file_parse() {
+	TemporaryFile file(R"( {"name":"John","children":[12,7]} )");
+	nosj::Value expected = nosj::Object{
+			{ "name", "John" },
+			{ "children", nosj::Array{12, 7} },
+	};
+
+	assert_eq(nosj::parseFile(file.path), expected);
+
+	nosj::MappedDocument document(file.path);
+	assert(document.size() == 35);
+	assert(std::string(document.data(), document.size()) == R"( {"name":"John","children":[12,7]} )");
+	assert_eq(document.parse(), expected);
+	assert_eq(document.parseParallel(2), expected);
+
+	assert_eq(document.lazyParse()["children"][1].value(), 7);
+
+	nosj::MappedDocument moved(std::move(document));
+	assert(document.data() == nullptr);
+	assert_eq(moved.parse(), expected);
+}
+
+void test_file_parse_array() {
+	TemporaryFile file("[1, 2.5, \"three\", [4], {\"five\":5}]");
+	nosj::Value expected = nosj::Array{1, 2.5, "three", nosj::Array{4}, nosj::Object{{"five", 5}}};
+
+	nosj::MappedDocument document(file.path);
+	assert_eq(document.parse(), expected);
+	assert_eq(document.parseParallel(2), expected);
+}
+
+void test_file_invalid() {
+	TemporaryFile empty("");
+	assert_throws(nosj::parseFile(empty.path), nosj::IncompleteInput);
+
+	TemporaryFile invalid("[1,2]x");
+	try {
+		nosj::parseFile(invalid.path);
+		assert(false);
+	} catch(nosj::UnexpectedCharacter& e) {
+		assert(e.character == 'x');
+		assert(e.position == 5);
+	}
+
+	try {
+		nosj::parseFile("/nonexistent/nosj.json");
+		assert(false);
+	} catch(nosj::FileError& e) {
+		assert(e.path == "/nonexistent/nosj.json");
+		assert(e.error == ENOENT);
+	}
+}
+
+void test_file_read_ahead() {
+	std::string contents = "[";
+	for(int i = 0; i < 1000; i++) {
+		contents += (i > 0 ? ", " : "") + std::string("{\"id\": ") + std::to_string(i) + ", \"name\": \"n\\u00e9" + std::to_string(i) + "\"}";
+	}
+	contents += "]\n";
+	TemporaryFile file(contents);
+	nosj::Value expected = nosj::parse(contents);
+
+	assert_eq(nosj::readFile(file.path), expected);
+	assert(nosj::tryReadFile(file.path).ok());
+
+	// Blocks smaller than the tokens, and a file size that is a multiple of the block size
+	std::vector<size_t> blockSizes = {1, 2, 7, 64, 4096, contents.size()};
+	for(size_t blockSize : blockSizes) {
+		nosj::ParseResult result = nosj::_details::tryReadFileAhead(file.path, nosj::ParseOptions(), blockSize, 2);
+		assert(result.ok());
+		assert_eq(result.value(), expected);
+	}
+}
+
+void test_file_read_ahead_invalid() {
+	TemporaryFile empty("");
+	assert_throws(nosj::readFile(empty.path), nosj::IncompleteInput);
+
+	TemporaryFile invalid("[1,\n 2]\n  x");
+	for(size_t blockSize : {1, 3, 1024}) {
+		nosj::ParseResult result = nosj::_details::tryReadFileAhead(invalid.path, nosj::ParseOptions(), blockSize, 3);
+		assert(!result.ok());
+		assert(result.error().kind == nosj::ParseError::Kind::UnexpectedCharacter);
+		assert(result.error().position == 10);
+		assert(result.error().line == 3);
+		assert(result.error().column == 3);
+	}
+
+	try {
+		nosj::readFile("/nonexistent/nosj.json");
+		assert(false);
+	} catch(nosj::FileError& e) {
+		assert(e.error == ENOENT);
+	}
+
+	try {
+		nosj::tryReadFile("/");
+		assert(false);
+	} catch(nosj::FileError& e) {
+		assert(e.error == EISDIR);
+	}
+}
+
+}
+
+namespace tests {
+	void file() {
+		TEST(file_parse);
+		TEST(file_parse_array);
+		TEST(file_invalid);
+		TEST(file_read_ahead);
+		TEST(file_read_ahead_invalid);
+	}
+}
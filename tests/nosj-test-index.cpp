@@ -0,0 +1,151 @@
+#include "nosj-test.hpp"
+#include "nosj/index.hpp"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace /*unnamed*/ {
+
+struct TemporaryFile {
+	std::string path;
+
+	TemporaryFile(const std::string& contents = "") {
+		char name[] = "/tmp/nosj-test-XXXXXX";
+		int fd = mkstemp(name);
+		assert(fd >= 0);
+		close(fd);
+		path = name;
+
+		std::ofstream os(path, std::ios::binary);
+		os << contents;
+	}
+
+	~TemporaryFile() {
+		std::remove(path.c_str());
+	}
+};
+
+const std::string array = R"([ {"id": 7, "name": "a"}, {"id": "x", "name": "b,]"}, 3 ,[{"id": 8}], {"id": 7}, {"name": "c"} ])";
+
+void test_index_array() {
+	TemporaryFile file(array);
+	nosj::FileIndex index = nosj::FileIndex::build(file.path, nosj::FileIndex::Layout::Array, "id");
+
+	assert(index.size() == 6);
+	assert(index.entry(0).offset == 2);
+	assert(index.entry(0).size == 22);
+	assert(index.entry(2).offset == 54);
+	assert(index.entry(2).size == 1);
+
+	assert_eq(index.readElement(1), nosj::Value(nosj::Object{{"id", "x"}, {"name", "b,]"}}));
+	assert_eq(index.readElement(2), 3);
+	assert_eq(index.readElement(3), nosj::Value(nosj::Array{nosj::Object{{"id", 8}}}));
+	assert_throws(index.readElement(6), std::out_of_range);
+
+	size_t found = 0;
+	assert(index.find(7, found)  &&  found == 0); // The first one
+	assert(index.find("x", found)  &&  found == 1);
+	assert(!index.find(8, found));
+	assert_eq(index.readElementByKey("x"), index.readElement(1));
+	assert_throws(index.readElementByKey("y"), std::out_of_range);
+
+	TemporaryFile empty("[ ]");
+	assert(nosj::FileIndex::build(empty.path).size() == 0);
+}
+
+void test_index_lines() {
+	TemporaryFile file("{\"id\": 1}\r\n\n[1, 2]\n  \"three\"  \n{\"id\": 4, \"x\": [\n");
+	nosj::FileIndex index = nosj::FileIndex::build(file.path, nosj::FileIndex::Layout::Lines, "id");
+
+	assert(index.size() == 4);
+	assert_eq(index.readElement(0), nosj::Value(nosj::Object{{"id", 1}}));
+	assert_eq(index.readElement(1), nosj::Value(nosj::Array{1, 2}));
+	assert_eq(index.readElement(2), "three");
+	// Only validated when read
+	assert_throws(index.readElement(3), nosj::IncompleteInput);
+	assert_eq(index.readElementByKey(1), index.readElement(0));
+}
+
+void test_index_save_load() {
+	TemporaryFile file(array);
+	TemporaryFile indexFile;
+	nosj::FileIndex::build(file.path, nosj::FileIndex::Layout::Array, "id").save(indexFile.path);
+
+	nosj::FileIndex index = nosj::FileIndex::load(file.path, indexFile.path);
+	assert(index.size() == 6);
+	assert(index.keyMember() == "id");
+	assert_eq(index.readElement(4), nosj::Value(nosj::Object{{"id", 7}}));
+	assert_eq(index.readElementByKey(7), index.readElement(0));
+	assert_eq(index.readElementByKey("x"), index.readElement(1));
+
+	// Not an index, or the index of another version of the file
+	assert_throws(nosj::FileIndex::load(file.path, file.path), nosj::InvalidIndex);
+	std::ofstream(file.path, std::ios::app) << " ";
+	assert_throws(nosj::FileIndex::load(file.path, indexFile.path), nosj::InvalidIndex);
+	assert_throws(index.readElement(0), nosj::InvalidIndex);
+}
+
+void test_index_same_size() {
+	TemporaryFile file(array);
+	TemporaryFile indexFile;
+	nosj::FileIndex::build(file.path).save(indexFile.path);
+	nosj::FileIndex index = nosj::FileIndex::load(file.path, indexFile.path);
+
+	// Edited in place a second later, with the same size
+	std::string edited = array;
+	edited.replace(edited.find("7"), 1, "9");
+	std::fstream(file.path, std::ios::binary | std::ios::in | std::ios::out) << edited;
+	struct stat status;
+	assert(stat(file.path.c_str(), &status) == 0);
+	struct timeval times[2] = {{status.st_atime, 0}, {status.st_mtime + 1, 0}};
+	assert(utimes(file.path.c_str(), times) == 0);
+	assert_throws(nosj::FileIndex::load(file.path, indexFile.path), nosj::InvalidIndex);
+	assert_throws(index.readElement(0), nosj::InvalidIndex);
+
+	// Replaced by another file of the same size
+	nosj::FileIndex::build(file.path).save(indexFile.path);
+	index = nosj::FileIndex::load(file.path, indexFile.path);
+	TemporaryFile replacement(array);
+	assert(std::rename(replacement.path.c_str(), file.path.c_str()) == 0);
+	assert_throws(nosj::FileIndex::load(file.path, indexFile.path), nosj::InvalidIndex);
+	assert_throws(index.readElement(0), nosj::InvalidIndex);
+}
+
+void test_index_corrupt_entry() {
+	TemporaryFile file("[1, 2]");
+	TemporaryFile indexFile;
+	nosj::FileIndex::build(file.path).save(indexFile.path);
+
+	// The first entry has offset 1: a size of 2^64 - 1 wraps the end around to 0
+	std::fstream fs(indexFile.path, std::ios::binary | std::ios::in | std::ios::out);
+	fs.seekp(sizeof(nosj::_details::indexMagic) + 3 * 8 + 8 + 4 + 8);
+	fs.write("\xff\xff\xff\xff\xff\xff\xff\xff", 8);
+	fs.close();
+	assert_throws(nosj::FileIndex::load(file.path, indexFile.path), nosj::InvalidIndex);
+}
+
+void test_index_invalid() {
+	TemporaryFile object("{}");
+	assert_throws(nosj::FileIndex::build(object.path), nosj::InvalidConversion);
+
+	TemporaryFile incomplete("[1, 2");
+	assert_throws(nosj::FileIndex::build(incomplete.path), nosj::IncompleteInput);
+
+	assert_throws(nosj::FileIndex::build("/nonexistent/nosj.json"), nosj::FileError);
+}
+
+}
+
+namespace tests {
+	void index() {
+		TEST(index_array);
+		TEST(index_lines);
+		TEST(index_save_load);
+		TEST(index_same_size);
+		TEST(index_corrupt_entry);
+		TEST(index_invalid);
+	}
+}
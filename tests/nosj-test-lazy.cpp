@@ -0,0 +1,121 @@
+#include "nosj-test.hpp"
+#include "nosj/lazy.hpp"
+#include <stdexcept>
+
+namespace /*unnamed*/ {
+
+const std::string document = join_lines({
+	R"({)",
+	R"(  "name"     : "John",)",
+	R"(  "age"      : 34.25,)",
+	R"(  "children" : [ 12, 7, {"a\"]}": [[]]} ],)",
+	R"(  "married"  : true,)",
+	R"(  "spouse"   : null,)",
+	R"(  "escaped" : "yes")",
+	R"(})",
+});
+
+void test_lazy_types() {
+	nosj::LazyValue v = nosj::lazyParse(document);
+	assert(v.type() == nosj::Value::ObjectValue);
+	assert(v.isObject());
+	assert(v["name"].isString());
+	assert(v["age"].isNumber());
+	assert(v["children"].isArray());
+	assert(v["married"].isBoolean());
+	assert(v["spouse"].isNull());
+
+	assert(nosj::lazyParse("  -1").isNumber());
+	assert(nosj::lazyParse("false").isBoolean());
+}
+
+void test_lazy_access() {
+	nosj::LazyValue v = nosj::lazyParse(document);
+	assert_eq(v["name"].value(), "John");
+	assert_eq(v["age"].value(), 34.25);
+	assert_eq(v["children"][0].value(), 12);
+	assert_eq(v["children"][1].value(), 7);
+	assert_eq(v["children"][2].value(), nosj::Value(nosj::Object{{"a\"]}", nosj::Array{nosj::emptyArray}}}));
+	assert_eq(v["married"].value(), true);
+	assert_eq(v["spouse"].value(), nosj::null);
+	assert_eq(v["escaped"].value(), "yes");
+
+	assert(v.contains("married"));
+	assert(!v.contains("divorced"));
+	assert(v.size() == 6);
+	assert(v["children"].size() == 3);
+	assert(nosj::lazyParse("[]").size() == 0);
+	assert(nosj::lazyParse(" { } ").size() == 0);
+
+	assert_throws(v["divorced"], std::out_of_range);
+	assert_throws(v["children"][3], std::out_of_range);
+	assert_throws(v[0], nosj::InvalidConversion);
+	assert_throws(v["children"]["name"], nosj::InvalidConversion);
+	assert_throws(v["name"].begin(), nosj::InvalidConversion);
+}
+
+void test_lazy_iteration() {
+	nosj::LazyValue v = nosj::lazyParse(document);
+
+	std::vector<std::string> keys;
+	for(auto it = v.begin(); it != v.end(); ++it) {
+		keys.push_back(it.key());
+	}
+	assert((keys == std::vector<std::string>{"name", "age", "children", "married", "spouse", "escaped"}));
+
+	nosj::Array children;
+	for(nosj::LazyValue child : v["children"]) {
+		children.push_back(child.value());
+	}
+	assert_eq(nosj::Value(children), v["children"].value());
+	assert_eq(v.value(), nosj::parse(document));
+
+	assert_throws(v["children"].begin().key(), nosj::InvalidConversion);
+}
+
+void test_lazy_invalid() {
+	// Skipped values are not validated
+	assert_eq(nosj::lazyParse(R"({"a":[x y],"b":1})")["b"].value(), 1);
+
+	try {
+		nosj::lazyParse(R"({"a":1 "b":2})")["b"];
+		assert(false);
+	} catch(nosj::UnexpectedCharacter& e) {
+		assert(e.character == '"');
+		assert(e.position == 7);
+		assert(e.line == 1);
+		assert(e.column == 8);
+	}
+
+	try {
+		nosj::lazyParse(R"([1,,2])")[2];
+		assert(false);
+	} catch(nosj::UnexpectedCharacter& e) {
+		assert(e.character == ',');
+		assert(e.position == 3);
+	}
+
+	try {
+		nosj::lazyParse(R"({"a":[1,2)")["a"][2];
+		assert(false);
+	} catch(nosj::UnexpectedCharacter&) {
+		assert(false);
+	} catch(nosj::IncompleteInput&) {
+		assert(true);
+	}
+
+	assert_throws(nosj::lazyParse(R"({"a":[1,2)")["b"], nosj::IncompleteInput);
+	assert_throws(nosj::lazyParse("").type(), nosj::IncompleteInput);
+	assert_throws(nosj::lazyParse("[1,2]")[0].value().asArray(), nosj::InvalidConversion);
+}
+
+}
+
+namespace tests {
+	void lazy() {
+		TEST(lazy_types);
+		TEST(lazy_access);
+		TEST(lazy_iteration);
+		TEST(lazy_invalid);
+	}
+}
@@ -0,0 +1,86 @@
+#include "nosj-test.hpp"
+#include "nosj/literal.hpp"
+#include <string>
+#include <vector>
+
+namespace /*unnamed*/ {
+
+static_assert(nosj::_details::isValidLiteral("[1, {\"a\": null}]", 16), "A valid literal must pass the check");
+static_assert(!nosj::_details::isValidLiteral("[1, {\"a\": nul}]", 15), "An invalid literal must fail the check");
+static_assert(!nosj::_details::isValidLiteral("[1, 2", 5), "An incomplete literal must fail the check");
+static_assert(!nosj::_details::isValidLiteral("[1, 2,]", 7), "A trailing comma must fail the check");
+
+const nosj::Value& defaults() {
+	return NOSJ_JSON(R"({"retries": 3, "hosts": ["a", "b"], "verbose": false})");
+}
+
+void test_literal_value() {
+	const nosj::Value& v = defaults();
+	assert_eq(v, nosj::parse(R"({"retries": 3, "hosts": ["a", "b"], "verbose": false})"));
+	assert_eq(v.asObject().at("retries"), 3);
+	assert_eq(v.asObject().at("hosts").asArray()[1], "b");
+
+	assert_eq(NOSJ_JSON("null"), nosj::null);
+	assert_eq(NOSJ_JSON(" \"\\u00e9\\ud83d\\ude00\" "), "\u00e9\U0001F600");
+	assert_eq(NOSJ_JSON("-1.5e3"), -1500);
+}
+
+void test_literal_parsed_once() {
+	const nosj::Value* first = &defaults();
+	for(int i = 0; i < 10; i++) {
+		assert(&defaults() == first);
+	}
+}
+
+void test_literal_check() {
+	// The checker must agree with the parser
+	std::vector<std::string> texts = {
+		"null", "true", "false", "0", "-0", "12", "-12.5", "1e5", "1E+5", "1.5e-5", "\"\"", "\"a\\\"b\"",
+		"\"\\/\\b\\f\\n\\r\\t\"", "\"\\u0041\"", "\"\\uD83D\\uDE00\"", "\"\\uDE00\"", "[]", "[ ]", "[1,[2,[3]]]",
+		"{}", "{ \"a\" : 1 , \"b\" : [true] }", " \t\r\n1 \n",
+		"", " ", "nul", "nulll", "True", "01", "-", "1.", ".5", "1e", "+1", "\"", "\"\\x\"", "\"\\u12\"",
+		"\"\\uD83D\"", "\"\\uD83D\\u0041\"", "\"a\tb\"", "[", "[1", "[1,]", "[,1]", "[1 2]", "{", "{\"a\"}",
+		"{\"a\":}", "{\"a\":1,}", "{1:2}", "{\"a\" 1}", "1 2", "[]]",
+	};
+	for(auto& text : texts) {
+		bool valid = nosj::_details::isValidLiteral(text.data(), text.size());
+		bool parsed = nosj::tryParse(text).ok();
+		assert(valid == parsed);
+	}
+
+	assert(nosj::_details::isValidLiteral("[1]x", 3));
+	assert(!nosj::_details::isValidLiteral("[1]", 2));
+}
+
+void test_literal_long() {
+	// The check must not recurse once per character
+	std::string text = "[";
+	for(int i = 0; i < 20000; i++) {
+		text += "1,";
+	}
+	text += "\"end\"]";
+	assert(nosj::_details::isValidLiteral(text.data(), text.size()));
+
+	assert_eq(NOSJ_JSON(R"([0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,
+		0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,
+		0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,
+		0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,
+		0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9])").asArray().size(), 200u);
+
+	// Up to 64 levels of nesting
+	std::string nested = std::string(64, '[') + std::string(64, ']');
+	assert(nosj::_details::isValidLiteral(nested.data(), nested.size()));
+	nested = "[" + nested + "]";
+	assert(!nosj::_details::isValidLiteral(nested.data(), nested.size()));
+}
+
+}
+
+namespace tests {
+	void literal() {
+		TEST(literal_value);
+		TEST(literal_parsed_once);
+		TEST(literal_check);
+		TEST(literal_long);
+	}
+}
@@ -1,6 +1,11 @@
 #include "nosj-test.hpp"
 #include "nosj/parse.hpp"
+#include "nosj/stringify.hpp"
+#include <algorithm>
+#include <atomic>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 
 namespace /*unnamed*/ {
 
@@ -50,7 +55,7 @@ void assert_parse_stream_unexpected(const std::string& str, char unexpectedChar,
 		assert(false);
 	} catch(nosj::UnexpectedCharacter& e) {
 		assert(e.character == unexpectedChar);
-		assert(e.position == position);
+		assert(e.position == std::uint64_t(position));
 	}
 
 	is.seekg(0);
@@ -59,7 +64,7 @@ void assert_parse_stream_unexpected(const std::string& str, char unexpectedChar,
 		assert(false);
 	} catch(nosj::UnexpectedCharacter& e) {
 		assert(e.character == unexpectedChar);
-		assert(e.position == position);
+		assert(e.position == std::uint64_t(position));
 	}
 }
 
@@ -460,6 +465,611 @@ void test_parse_object() {
 	assert_parse_unexpected(R"({"key":"value",,})", ',', 15);
 }
 
+void assert_parse_parallel_unexpected(const std::string& str, char unexpectedChar, unsigned int position) {
+	try {
+		nosj::parseParallel(str, 4);
+		assert(false);
+	} catch(nosj::UnexpectedCharacter& e) {
+		assert(e.character == unexpectedChar);
+		assert(e.position == position);
+	}
+}
+
+void test_parse_parallel() {
+	std::string str = "[";
+	nosj::Array expected;
+	for(int i = 0; i < 1000; i++) {
+		if(i > 0) {
+			str += " ,\n";
+		}
+		str += R"({"id":)" + std::to_string(i) + R"(,"name":"a,b]\"c","tags":[1,[2,{}]]})";
+		expected.push_back(nosj::Object{
+				{ "id", i },
+				{ "name", "a,b]\"c" },
+				{ "tags", nosj::Array{1, nosj::Array{2, nosj::emptyObject}} },
+		});
+	}
+	str += "] ";
+
+	assert_eq(nosj::parseParallel(str, 4), nosj::Value(expected));
+	assert_eq(nosj::parseParallel(str, 1), nosj::Value(expected));
+	assert_eq(nosj::parseParallel(str), nosj::Value(expected));
+
+	assert_eq(nosj::parseParallel("[]", 4),    nosj::emptyArray);
+	assert_eq(nosj::parseParallel(" [ ] ", 4), nosj::emptyArray);
+	assert_eq(nosj::parseParallel("[1,2,3]", 4), nosj::Value(nosj::Array{1, 2, 3}));
+	assert_eq(nosj::parseParallel(R"({"a":[1,2]})", 4), nosj::Value(nosj::Object{{"a", nosj::Array{1, 2}}}));
+	assert_eq(nosj::parseParallel("7", 4), 7);
+
+	assert_parse_parallel_unexpected("[1,,2]", ',', 3);
+	assert_parse_parallel_unexpected("[1,2,]", ']', 5);
+	assert_parse_parallel_unexpected("[1,2 3]", '3', 5);
+	assert_parse_parallel_unexpected("[1,[2}]", '}', 5);
+	assert_parse_parallel_unexpected("[1,2] 3", '3', 6);
+	assert_parse_parallel_unexpected("[1,2]]", ']', 5);
+
+	std::string invalidTail = str;
+	invalidTail.insert(invalidTail.size() - 10, "x");
+	try {
+		nosj::parseParallel(invalidTail, 4);
+		assert(false);
+	} catch(nosj::UnexpectedCharacter& e) {
+		assert(e.character == 'x');
+		assert(e.position == invalidTail.size() - 11);
+	}
+
+	try {
+		nosj::parseParallel("[1,2", 4);
+		assert(false);
+	} catch(nosj::IncompleteInput&) {
+		assert(true);
+	}
+}
+
+void assert_parse_projection(const std::string& str, const nosj::Projection& projection, const nosj::Value& expectedValue) {
+	assert_eq(nosj::parse(str, projection), expectedValue);
+
+	std::istringstream is(str);
+	nosj::Value v = nosj::readFrom(is, projection);
+	assert_eq(v, expectedValue);
+}
+
+void test_parse_projection() {
+	const std::string str = join_lines({
+		R"({)",
+		R"(  "user" : { "id" : 7, "name" : "John", "tags" : ["a", "b"] },)",
+		R"(  "items" : [)",
+		R"(    { "price" : 1.25, "name" : "nosj" },)",
+		R"(    { "name" : "json" },)",
+		R"(    { "price" : 3, "a/b~" : [null] })",
+		R"(  ],)",
+		R"(  "count" : 3)",
+		R"(})",
+	});
+
+	assert_parse_projection(str, {"/user/id", "/items/*/price"},
+			nosj::Object {
+					{ "user", nosj::Object{{ "id", 7 }} },
+					{ "items", nosj::Array {
+							nosj::Object{{ "price", 1.25 }},
+							nosj::emptyObject,
+							nosj::Object{{ "price", 3 }},
+					}},
+			}
+	);
+
+	assert_parse_projection(str, {"/user"},
+			nosj::Object {
+					{ "user", nosj::Object{{ "id", 7 }, { "name", "John" }, { "tags", nosj::Array{"a", "b"} }} },
+			}
+	);
+
+	assert_parse_projection(str, {"/items/1", "/items/2/a~1b~0", "/count", "/missing/path"},
+			nosj::Object {
+					{ "items", nosj::Array {
+							nosj::null,
+							nosj::Object{{ "name", "json" }},
+							nosj::Object{{ "a/b~", nosj::Array{nosj::null} }},
+					}},
+					{ "count", 3 },
+			}
+	);
+
+	assert_parse_projection(str, {"/*/name", "/user/tags/1"},
+			nosj::Object {
+					{ "user", nosj::Object{{ "name", "John" }, { "tags", nosj::Array{nosj::null, "b"} }} },
+					{ "items", nosj::Array{nosj::null, nosj::null, nosj::null} },
+			}
+	);
+
+	assert_parse_projection(str, {""}, nosj::parse(str));
+	assert_parse_projection(str, {}, nosj::emptyObject);
+	assert_parse_projection("[1,[2,3]]", {"/1/0"}, nosj::Array{nosj::null, nosj::Array{2, nosj::null}});
+
+	// Skipped values are still validated
+	assert_throws(nosj::parse(R"({"a":1,"b":[1,2,}])", {"/a"}), nosj::UnexpectedCharacter);
+	assert_throws(nosj::parse(R"({"a":1,"b":"\x"})", {"/a"}), nosj::UnexpectedCharacter);
+	assert_throws(nosj::parse(R"({"a":1,"b":01})", {"/a"}), nosj::UnexpectedCharacter);
+	assert_throws(nosj::parse(R"({"a":1,"b":[)", {"/a"}), nosj::IncompleteInput);
+	assert_throws(nosj::parse(R"({"a":1} 2)", {"/a"}), nosj::UnexpectedCharacter);
+
+	assert_throws(nosj::Projection({"user"}), nosj::InvalidProjectionPath);
+	assert_throws(nosj::Projection({"/a~2"}), nosj::InvalidProjectionPath);
+}
+
+void assert_parse_valid_utf8(const std::string& str) {
+	nosj::ParseOptions options;
+	options.validateUTF8 = true;
+
+	std::string quoted = '"' + str + '"';
+	assert_eq(nosj::parse(quoted, options), str);
+
+	std::istringstream is(quoted);
+	nosj::Value v = nosj::readFrom(is, options);
+	assert_eq(v, str);
+}
+
+void assert_parse_invalid_utf8(const std::string& str, unsigned int expectedPosition) {
+	nosj::ParseOptions options;
+	options.validateUTF8 = true;
+
+	std::string quoted = R"(["a", ")" + str + "\"]";
+	assert_eq(nosj::parse(quoted), nosj::Value(nosj::Array{"a", str}));
+
+	try {
+		nosj::parse(quoted, options);
+		assert(false);
+	} catch(nosj::InvalidUTF8& e) {
+		assert(e.position == expectedPosition + 7);
+	}
+
+	std::istringstream is(quoted);
+	try {
+		nosj::readFrom(is, options);
+		assert(false);
+	} catch(nosj::InvalidUTF8& e) {
+		assert(e.position == expectedPosition + 7);
+	}
+}
+
+void test_parse_utf8_validation() {
+	assert_parse_valid_utf8("");
+	assert_parse_valid_utf8("Hello, world! This is a somewhat long ASCII string.");
+	assert_parse_valid_utf8(u8"\u0080\u07FF\u0800\uFFFD\U00010000\U0010FFFF");
+	assert_parse_valid_utf8(u8"Um texto em portugu\u00EAs com acentua\u00E7\u00E3o e \u6C34 e \U0001D11E no fim");
+	assert_parse_valid_utf8("\xED\x9F\xBF"); // U+D7FF
+	assert_parse_valid_utf8("\xEE\x80\x80"); // U+E000
+
+	assert_parse_invalid_utf8("\x80", 0);                 // Lone continuation byte
+	assert_parse_invalid_utf8("abc\xBF", 3);
+	assert_parse_invalid_utf8("\xC0\x80", 0);             // Overlong
+	assert_parse_invalid_utf8("\xC1\xBF", 0);
+	assert_parse_invalid_utf8("\xE0\x9F\xBF", 0);
+	assert_parse_invalid_utf8("\xF0\x8F\xBF\xBF", 0);
+	assert_parse_invalid_utf8("\xED\xA0\x80", 0);         // Surrogate
+	assert_parse_invalid_utf8("\xF4\x90\x80\x80", 0);     // Above U+10FFFF
+	assert_parse_invalid_utf8("\xF5\x80\x80\x80", 0);
+	assert_parse_invalid_utf8("\xFF", 0);
+	assert_parse_invalid_utf8("ab\xC3", 2);                // Truncated
+	assert_parse_invalid_utf8("ab\xE6\xB0", 2);
+	assert_parse_invalid_utf8("0123456789abcdef0123456789\xE6\xB0x0123456789abcdef", 26);
+	assert_parse_invalid_utf8(u8"0123456789abcdef\u6C34\u6C34\u6C34\u6C34\u6C34\xE6", 31);
+
+	// Mostly multibyte text, which is validated by blocks, with an error at
+	// each sequence in turn
+	std::string text;
+	for(int i = 0; text.size() < 200; i++) {
+		text += i % 3 == 0 ? u8"\u0436" : (i % 3 == 1 ? u8"\u6C34 " : u8"\U0001F600");
+	}
+	assert_parse_valid_utf8(text);
+	for(size_t i = 0; i < text.size(); i++) {
+		if((text[i] & 0xC0) == 0x80  ||  text[i] == ' ') {
+			continue;
+		}
+		assert_parse_invalid_utf8(text.substr(0, i) + "\xFF" + text.substr(i), i);
+		assert_parse_invalid_utf8(text.substr(0, i) + text.substr(i + 1), i);     // Lead byte missing
+		assert_parse_invalid_utf8(text.substr(0, i) + "\xE6\xB0" + text.substr(i), i); // Truncated
+		assert_parse_invalid_utf8(text.substr(0, i) + "\xED\xA0\x80" + text.substr(i), i);
+	}
+}
+
+void assert_try_parse_error(const std::string& str, nosj::ParseError::Kind kind, unsigned int position, char character = '\0') {
+	nosj::ParseResult result = nosj::tryParse(str);
+	assert(!result.ok());
+	assert(!result);
+	assert(result.error());
+	assert(result.error().kind == kind);
+	if(kind != nosj::ParseError::Kind::IncompleteInput) {
+		assert(result.error().position == position);
+	}
+	assert(result.error().character == character);
+}
+
+void test_parse_try() {
+	nosj::ParseResult result = nosj::tryParse(R"( {"a":[1,2.5]} )");
+	assert(result.ok());
+	assert(result);
+	assert(!result.error());
+	assert(result.error().kind == nosj::ParseError::Kind::None);
+	assert_eq(result.value(), nosj::Value(nosj::Object{{"a", nosj::Array{1, 2.5}}}));
+
+	std::istringstream is("[true] null");
+	result = nosj::tryReadFrom(is);
+	assert(result.ok());
+	assert_eq(result.value(), nosj::Value(nosj::Array{true}));
+
+	result = nosj::tryParse(R"({"a":1,"b":2})", {"/b"});
+	assert(result.ok());
+	assert_eq(result.value(), nosj::Value(nosj::Object{{"b", 2}}));
+
+	using Kind = nosj::ParseError::Kind;
+	assert_try_parse_error("",            Kind::IncompleteInput, 0);
+	assert_try_parse_error("[1,2",        Kind::IncompleteInput, 0);
+	assert_try_parse_error("[1,,2]",      Kind::UnexpectedCharacter, 3, ',');
+	assert_try_parse_error("nul",         Kind::IncompleteInput, 0);
+	assert_try_parse_error("[null] x",    Kind::UnexpectedCharacter, 7, 'x');
+	assert_try_parse_error(R"("\uD800")", Kind::ExpectedTrailCodePoint, 7);
+	assert_try_parse_error("99999999999999999999", Kind::NumberOutOfRange, 0);
+	assert_try_parse_error("[1, -99999999999999999999]", Kind::NumberOutOfRange, 4);
+	assert_try_parse_error("[1e99999]",   Kind::NumberOutOfRange, 1);
+
+	assert_eq(nosj::parse("1e-99999"), 0.0);
+	assert_throws(nosj::parse("1e99999"), nosj::NumberOutOfRange);
+
+	nosj::ParseOptions options;
+	options.validateUTF8 = true;
+	result = nosj::tryParse("[\"\xFF\"]", options);
+	assert(result.error().kind == Kind::InvalidUTF8);
+	assert(result.error().position == 2);
+
+	result = nosj::tryParse(R"({"key":"value":})");
+	assert(result.error().message() == R"(Unexpected character '\u003A' at position 14 (line 1, column 15))");
+	assert_throws(result.value(), nosj::UnexpectedCharacter);
+	try {
+		result.error().raise();
+		assert(false);
+	} catch(nosj::UnexpectedCharacter& e) {
+		assert(e.character == ':');
+		assert(e.position == 14);
+		assert(std::string(e.what()) == R"(Unexpected character '\u003A' at position 14 (line 1, column 15))");
+	}
+
+	assert(nosj::tryParse("[").error().message() == "Incomplete input");
+	assert(nosj::tryParse("[\"\xC3\xA9").error().kind == Kind::IncompleteInput);
+	assert(nosj::tryParse("\xC3").error().message() == R"(Unexpected character '\u00C3' at position 0 (line 1, column 1))");
+	assert(nosj::tryParse(R"("\uD800x")").error().message() == "Expected trail code point at position 7 (line 1, column 8)");
+	assert_throws(nosj::tryParse(R"("\uD800x")").value(), nosj::ExpectedTrailCodePoint);
+}
+
+template <typename Char>
+std::string encodeUnits(const std::basic_string<Char>& str, bool bigEndian) {
+	std::string bytes;
+	for(Char unit : str) {
+		for(size_t i = 0; i < sizeof(Char); i++) {
+			size_t shift = 8 * (bigEndian ? sizeof(Char) - 1 - i : i);
+			bytes += char((static_cast<unsigned long>(unit) >> shift) & 0xFF);
+		}
+	}
+	return bytes;
+}
+
+void test_parse_encoding() {
+	using nosj::Encoding;
+	assert(nosj::detectEncoding("[1]") == Encoding::UTF8);
+	assert(nosj::detectEncoding("1") == Encoding::UTF8);
+	assert(nosj::detectEncoding("") == Encoding::UTF8);
+	assert(nosj::detectEncoding(encodeUnits(std::u16string(u"[1]"), false)) == Encoding::UTF16LE);
+	assert(nosj::detectEncoding(encodeUnits(std::u16string(u"[1]"), true))  == Encoding::UTF16BE);
+	assert(nosj::detectEncoding(encodeUnits(std::u16string(u"1"), false))   == Encoding::UTF16LE);
+	assert(nosj::detectEncoding(encodeUnits(std::u32string(U"1"), false))   == Encoding::UTF32LE);
+	assert(nosj::detectEncoding(encodeUnits(std::u32string(U"1"), true))    == Encoding::UTF32BE);
+	assert(nosj::detectEncoding("\xEF\xBB\xBF[]") == Encoding::UTF8);
+	assert(nosj::detectEncoding(encodeUnits(std::u16string(u"﻿é"), false)) == Encoding::UTF16LE);
+	assert(nosj::detectEncoding(encodeUnits(std::u16string(u"﻿é"), true))  == Encoding::UTF16BE);
+
+	const nosj::Value expected = nosj::parse(u8"{\"héllo\": [\"wörld \U0001F600\", 1.5, true, null]}");
+	const std::u16string utf16 = u"{\"héllo\": [\"wörld \U0001F600\", 1.5, true, null]}";
+	const std::u32string utf32 = U"{\"héllo\": [\"wörld \U0001F600\", 1.5, true, null]}";
+	assert_eq(nosj::parse(utf16), expected);
+	assert_eq(nosj::parse(utf32), expected);
+	assert_eq(nosj::parse(encodeUnits(utf16, false)), expected);
+	assert_eq(nosj::parse(encodeUnits(utf16, true)), expected);
+	assert_eq(nosj::parse(encodeUnits(utf32, false)), expected);
+	assert_eq(nosj::parse(encodeUnits(utf32, true)), expected);
+	assert_eq(nosj::parse(encodeUnits(u"﻿" + utf16, false)), expected);
+	assert_eq(nosj::parse(u"﻿" + utf16), expected);
+	assert_eq(nosj::parse("\xEF\xBB\xBF" "[1]"), nosj::Value(nosj::Array{1}));
+	assert_eq(nosj::parse(encodeUnits(std::u16string(u"7"), false)), 7);
+	assert_eq(nosj::parse(encodeUnits(std::u16string(u"{\"a\":[1],\"b\":2}"), false), {"/a"}),
+	          nosj::Value(nosj::Object{{"a", nosj::Array{1}}}));
+
+	// Longer than a transcoding window
+	std::string longUTF8 = "[";
+	std::u16string longUTF16 = u"[";
+	for(int i = 0; i < 2000; i++) {
+		longUTF8  += u8"\"abé\U0001F600 cd\", 12345, ";
+		longUTF16 +=  u"\"abé\U0001F600 cd\", 12345, ";
+	}
+	longUTF8 += "0]";
+	longUTF16 += u"0]";
+	assert_eq(nosj::parse(longUTF16), nosj::parse(longUTF8));
+	assert_eq(nosj::parse(encodeUnits(longUTF16, true)), nosj::parse(longUTF8));
+
+	// Positions count the code units of wide strings and the bytes of others
+	using Kind = nosj::ParseError::Kind;
+	assert(nosj::tryParse(u"[\"\U0001F600\", x]").error().position == 7);
+	assert(nosj::tryParse(U"[\"\U0001F600\", x]").error().position == 6);
+	assert(nosj::tryParse(encodeUnits(std::u16string(u"[1,,2]"), false)).error().position == 6);
+	nosj::ParseResult result = nosj::tryParse(longUTF16.substr(0, longUTF16.size() - 2) + u"x]");
+	assert(result.error().kind == Kind::UnexpectedCharacter);
+	assert(result.error().position == longUTF16.size() - 2);
+	assert(result.error().character == 'x');
+
+	std::u16string loneSurrogate = u"[\"a";
+	loneSurrogate += char16_t(0xD800);
+	loneSurrogate += u"b\"]";
+	result = nosj::tryParse(loneSurrogate);
+	assert(result.error().kind == Kind::InvalidEncoding);
+	assert(result.error().position == 3);
+	assert(result.error().message() == "Invalid code unit sequence at position 3 (line 1, column 4)");
+	assert_throws(nosj::parse(loneSurrogate), nosj::InvalidEncoding);
+
+	std::u32string outOfRange = U"[1, ";
+	outOfRange += char32_t(0x110000);
+	result = nosj::tryParse(outOfRange);
+	assert(result.error().kind == Kind::InvalidEncoding);
+	assert(result.error().position == 4);
+
+	std::string truncated = encodeUnits(std::u16string(u"[1]"), false);
+	result = nosj::tryParse(truncated.substr(0, 5));
+	assert(result.error().kind == Kind::InvalidEncoding);
+	assert(result.error().position == 4);
+	result = nosj::tryParse(encodeUnits(std::u16string(u"[1] "), false) + "x");
+	assert(result.error().kind == Kind::InvalidEncoding);
+	assert(result.error().position == 8);
+}
+
+void test_parse_into() {
+	nosj::Value target = nosj::parse(R"({"name":"a rather long name","tags":["x","y","z"],"n":1,"ok":true})");
+	const char* nameData = target.asObject().at("name").asString().data();
+	const nosj::Value* firstTag = &target.asObject().at("tags").asArray()[0];
+
+	std::string input = R"({"name":"short","tags":["w"],"n":2.5,"ok":false,"new":null})";
+	nosj::parseInto(target, input);
+	assert_eq(target, nosj::parse(input));
+	assert(target.asObject().at("name").asString().data() == nameData);
+	assert(&target.asObject().at("tags").asArray()[0] == firstTag);
+
+	input = R"({"tags":["w","v",[1,{"a":1}]],"n":"not a number"})";
+	nosj::parseInto(target, input);
+	assert_eq(target, nosj::parse(input));
+
+	input = R"({"tags":["w",[2,{"b":{}}],[]],"n":[]})";
+	nosj::parseInto(target, input);
+	assert_eq(target, nosj::parse(input));
+
+	// Duplicate keys keep the first value, as with parse()
+	for(std::string input : {R"({"a":1,"a":2})", R"({"a":{"b":[1,2]},"c":3,"a":{"b":"x","d":4}})",
+	                         R"({"c":{"e":1,"e":[2],"f":2},"a":[true],"c":null})"}) {
+		nosj::parseInto(target, input);
+		assert_eq(target, nosj::parse(input));
+	}
+	assert_eq(target.asObject().at("c").asObject().at("e"), 1);
+	assert_throws(nosj::parseInto(target, R"({"a":1,"a":[2})"), nosj::UnexpectedCharacter);
+
+	nosj::parseInto(target, "[true, null, {}]");
+	assert_eq(target, nosj::Value(nosj::Array{true, nosj::null, nosj::Object{}}));
+	nosj::parseInto(target, " 7 ");
+	assert_eq(target, 7);
+
+	std::istringstream is(R"(["x", 1] "next")");
+	nosj::parseInto(target, is);
+	assert_eq(target, nosj::Value(nosj::Array{"x", 1}));
+
+	nosj::parseInto(target, nosj::stringify(nosj::Value("é"), nosj::Encoding::UTF16LE));
+	assert_eq(target, nosj::Value(u8"é"));
+
+	assert_throws(nosj::parseInto(target, "[1, 2"), nosj::IncompleteInput);
+	assert_throws(nosj::parseInto(target, R"({"a" 1})"), nosj::UnexpectedCharacter);
+}
+
+void test_parse_parser() {
+	nosj::Parser parser;
+	assert_eq(parser.parse("[1, 2.5, \"a\"]"), nosj::Value(nosj::Array{1, 2.5, "a"}));
+	assert_eq(parser.parse(R"({"n": 123456789012345678})"), nosj::Value(nosj::Object{{"n", 123456789012345678LL}}));
+	assert_eq(parser.parse("-0.000001e-3"), -0.000001e-3L);
+	assert_eq(parser.parse(encodeUnits(std::u16string(u"[true]"), true)), nosj::Value(nosj::Array{true}));
+
+	std::istringstream is("[null] {}");
+	nosj::Value first = parser.readFrom(is);
+	nosj::Value second = parser.readFrom(is);
+	assert_eq(first, nosj::Value(nosj::Array{nosj::null}));
+	assert_eq(second, nosj::Value(nosj::Object{}));
+
+	nosj::Value target;
+	for(int i = 0; i < 3; i++) {
+		std::string input = R"({"id":)" + std::to_string(i) + R"(,"items":[{"k":"v"},{"k":"w"}]})";
+		parser.parseInto(target, input);
+		assert_eq(target, nosj::parse(input));
+	}
+	is.str(R"(["x"])");
+	is.clear();
+	parser.parseInto(target, is);
+	assert_eq(target, nosj::Value(nosj::Array{"x"}));
+
+	// Failed parses into objects leave no scratch behind
+	nosj::_details::ReaderScratch scratch;
+	for(const char* input : {R"({"a":1,"b":{"c":2,"d":[)", R"({"a":1,"b" 2})", R"({"a":{"b":x}})", R"({"a":1,"b":2,})"}) {
+		for(int i = 0; i < 3; i++) {
+			nosj::_details::ReadDocumentInto action{target};
+			std::string text = input;
+			assert(!nosj::_details::readDetected(text.data(), text.data() + text.size(), nosj::ParseOptions(), action,
+			                                     &scratch).ok());
+			assert(scratch.visitedMembers.empty());
+			assert_throws(parser.parseInto(target, input), nosj::ParseException);
+		}
+	}
+	parser.parseInto(target, R"({"a":1})");
+	assert_eq(target, nosj::Value(nosj::Object{{"a", 1}}));
+
+	assert(parser.tryParse("[1,").error().kind == nosj::ParseError::Kind::IncompleteInput);
+	assert_throws(parser.parse("[1 2]"), nosj::UnexpectedCharacter);
+	assert_eq(parser.parse("[3]"), nosj::Value(nosj::Array{3}));
+	is.str("x");
+	is.clear();
+	assert(parser.tryReadFrom(is).error().kind == nosj::ParseError::Kind::UnexpectedCharacter);
+
+	assert(parser.tryParse("\"\xFF\"").ok());
+	parser.options.validateUTF8 = true;
+	assert(parser.tryParse("\"\xFF\"").error().kind == nosj::ParseError::Kind::InvalidUTF8);
+	nosj::ParseOptions options;
+	options.validateUTF8 = true;
+	assert_throws(nosj::Parser(options).parse("\"\xFF\""), nosj::InvalidUTF8);
+}
+
+void assert_parse_location(const nosj::ParseResult& result, std::uint64_t position, std::uint64_t line, std::uint64_t column) {
+	assert(!result.ok());
+	assert(result.error().position == position);
+	assert(result.error().line == line);
+	assert(result.error().column == column);
+}
+
+void test_parse_location() {
+	const std::string input = "{\n  \"a\": [1, 2],\n  \"b\": tru\n}";
+	assert_parse_location(nosj::tryParse(input), 27, 3, 11);
+	assert_parse_location(nosj::tryParse("\n\n\n   x"), 6, 4, 4);
+	assert_parse_location(nosj::tryParse("[\n1e99999]"), 2, 2, 1);
+	assert_parse_location(nosj::tryParse(u"[1,\n\n  \U0001F600]"), 7, 3, 3);
+	assert_parse_location(nosj::tryParse(encodeUnits(std::u16string(u"[\r\n x]"), true)), 8, 2, 3);
+	assert_parse_location(nosj::tryParse("[1,\n 2]\n ,", {"/0"}), 9, 3, 2);
+
+	std::istringstream is(input);
+	assert_parse_location(nosj::tryReadFrom(is), 27, 3, 11);
+
+	// A line feed in a string ends no line of streams before the error on it
+	const std::string lineFeedInString = "[1,\n \"a\nb\"]";
+	assert_parse_location(nosj::tryParse(lineFeedInString), 7, 2, 4);
+	std::istringstream lineFeedStream(lineFeedInString);
+	assert_parse_location(nosj::tryReadFrom(lineFeedStream), 7, 2, 4);
+
+	try {
+		nosj::parse(input);
+		assert(false);
+	} catch(nosj::UnexpectedCharacter& e) {
+		assert(e.position == 27);
+		assert(e.line == 3);
+		assert(e.column == 11);
+		assert(std::string(e.what()) == R"(Unexpected character '\u000A' at position 27 (line 3, column 11))");
+	}
+
+	std::string array = "[";
+	for(int i = 0; i < 1000; i++) {
+		array += "\n  [1, 2, 3],";
+	}
+	array += "\n  [1, 2 3]\n]";
+	try {
+		nosj::parseParallel(array, 4);
+		assert(false);
+	} catch(nosj::UnexpectedCharacter& e) {
+		assert(e.line == 1002);
+		assert(e.column == 9);
+		assert(e.position == array.size() - 4);
+	}
+
+	nosj::ParseResult result = nosj::tryParse("[");
+	assert(result.error().line == 1);
+	assert(result.error().column == 2);
+	assert(result.error().message() == "Incomplete input");
+}
+
+void test_parse_batch() {
+	std::vector<std::string> documents;
+	for(int i = 0; i < 500; i++) {
+		documents.push_back(R"({"id":)" + std::to_string(i) + R"(,"tags":["a","b"]})");
+	}
+	documents[100] = "[1,";
+	documents[200] = R"({"id" 1})";
+
+	std::vector<nosj::ParseResult> results = nosj::parseBatch(documents, 4);
+	assert(results.size() == documents.size());
+	for(size_t i = 0; i < documents.size(); i++) {
+		if(i == 100) {
+			assert(results[i].error().kind == nosj::ParseError::Kind::IncompleteInput);
+		} else if(i == 200) {
+			assert(results[i].error().kind == nosj::ParseError::Kind::UnexpectedCharacter);
+			assert(results[i].error().position == 6);
+		} else {
+			assert(results[i].ok());
+			assert_eq(results[i].value(), nosj::parse(documents[i]));
+		}
+	}
+
+	const char buffer[] = "[1] {\"a\":true} null";
+	std::vector<nosj::BatchDocument> views{
+		nosj::BatchDocument(buffer, 3), nosj::BatchDocument(buffer + 4, 10), nosj::BatchDocument(buffer + 15, 4)
+	};
+	results = nosj::parseBatch(views, 1);
+	assert(results.size() == 3);
+	assert_eq(results[0].value(), nosj::Value(nosj::Array{1}));
+	assert_eq(results[1].value(), nosj::Value(nosj::Object{{"a", true}}));
+	assert_eq(results[2].value(), nosj::null);
+
+	assert(nosj::parseBatch(std::vector<std::string>()).empty());
+
+	nosj::ParseOptions options;
+	options.validateUTF8 = true;
+	results = nosj::parseBatch(std::vector<std::string>{"\"\xFF\"", "\"ok\""}, 2, options);
+	assert(results[0].error().kind == nosj::ParseError::Kind::InvalidUTF8);
+	assert_eq(results[1].value(), "ok");
+
+	// Batch after batch on the same threads, with the options of each batch
+	nosj::BatchParser parser(3);
+	assert(parser.threadCount() == 3);
+	for(int batch = 0; batch < 20; batch++) {
+		results = parser.parse(documents);
+		assert(results.size() == documents.size());
+		assert(!results[100].ok()  &&  !results[200].ok());
+		assert_eq(results[batch].value(), nosj::parse(documents[batch]));
+	}
+	parser.options = options;
+	results = parser.parse(std::vector<std::string>{"\"\xFF\"", "1"});
+	assert(results[0].error().kind == nosj::ParseError::Kind::InvalidUTF8);
+	assert_eq(results[1].value(), 1);
+	assert(parser.parse(std::vector<nosj::BatchDocument>()).empty());
+
+	// A thread that batches while another one does shares the threads of
+	// parseBatch() or starts its own
+	std::atomic<int> failures(0);
+	auto batches = [&]() {
+		for(int batch = 0; batch < 10; batch++) {
+			std::vector<nosj::ParseResult> own = nosj::parseBatch(documents);
+			if(own.size() != documents.size()  ||  own[100].ok()  ||  !(own[batch].value() == nosj::parse(documents[batch]))) {
+				failures++;
+			}
+		}
+	};
+	std::thread other(batches);
+	batches();
+	other.join();
+	assert(failures == 0);
+}
+
+void test_parse_worker_pool() {
+	nosj::_details::WorkerPool pool(4);
+	std::vector<int> counts(1000);
+	for(int round = 0; round < 50; round++) {
+		pool.parallelFor(counts.size(), [&](size_t i) { counts[i]++; });
+	}
+	for(int count : counts) {
+		assert(count == 50);
+	}
+
+	// The first exception, after which the pool goes on
+	assert_throws(pool.parallelFor(100, [](size_t i) { if(i == 10) throw std::runtime_error("x"); }), std::runtime_error);
+	pool.parallelFor(counts.size(), [&](size_t i) { counts[i] = 0; });
+	assert(std::count(counts.begin(), counts.end(), 0) == 1000);
+}
+
 void test_parse_invalid() {
 	assert_parse_incomplete("");
 	assert_parse_incomplete(" ");
@@ -475,6 +1085,16 @@ namespace tests {
 		TEST(parse_string);
 		TEST(parse_array);
 		TEST(parse_object);
+		TEST(parse_parallel);
+		TEST(parse_projection);
+		TEST(parse_utf8_validation);
+		TEST(parse_try);
+		TEST(parse_encoding);
+		TEST(parse_into);
+		TEST(parse_parser);
+		TEST(parse_location);
+		TEST(parse_batch);
+		TEST(parse_worker_pool);
 		TEST(parse_invalid);
 	}
 }
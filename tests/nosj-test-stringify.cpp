@@ -1,8 +1,20 @@
 #include "nosj-test.hpp"
+#include "nosj/parse.hpp"
 #include "nosj/stringify.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <initializer_list>
+#include <limits>
+#include <random>
 #include <set>
 #include <sstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
 namespace /*unnamed*/ {
 
@@ -43,6 +55,20 @@ void assert_stringify(const nosj::Value& v, const ExpectedSet& expected, const E
 
 	str = nosj::stringify(v, true);
 	assert(expectedPretty.count(str) == 1);
+
+	str = "";
+	{
+		nosj::StringSink sink(str);
+		nosj::writeTo(sink, v);
+	}
+	assert(expected.count(str) == 1);
+
+	char buffer[4096];
+	nosj::FixedBufferSink sink(buffer, sizeof(buffer));
+	nosj::writeTo(sink, v, true);
+	sink.flush();
+	assert(sink.fits());
+	assert(expectedPretty.count(std::string(buffer, sink.size())) == 1);
 }
 
 void assert_stringify(const nosj::Value& v, const std::string& expected, const std::string& expectedPretty_ = "") {
@@ -64,12 +90,115 @@ void test_stringify_number() {
 	assert_stringify(0, "0");
 	assert_stringify(468312354LL, "468312354");
 	assert_stringify(-468312354LL, "-468312354");
+	assert_stringify(std::numeric_limits<long long>::max(), "9223372036854775807");
+	assert_stringify(std::numeric_limits<long long>::min(), "-9223372036854775808");
 	assert_stringify(0.0, "0.0");
 	assert_stringify(156.015625, "156.015625");
 	assert_stringify(0.0001220703125, "0.0001220703125");
 	assert_stringify(-156.015625, "-156.015625");
 	assert_stringify(-0.0001220703125, "-0.0001220703125");
 	assert_stringify(0.0000152587890625, "1.52587890625e-05");
+
+	// The fewest digits that read back the same, as the parser reads floats
+	assert_stringify(0.1L, "0.1");
+	assert_stringify(0.3L, "0.3");
+	assert_stringify(12345.678L, "12345.678");
+	assert_stringify(-0.0, "-0.0");
+	assert_stringify(1e20, "1e+20");
+	assert_stringify(1e15, "1000000000000000.0");
+	assert_stringify(1e16, "1e+16");
+	assert_stringify(100.0, "100.0");
+	assert_stringify(123456789.0L, "123456789.0");
+	assert_stringify(9007199254740993.0, "9007199254740992.0");
+	assert_stringify(1.0L / 3, "0.33333333333333333334");
+	assert_stringify(8707574188118886365.0L, "8.707574188118886365e+18");
+	assert_stringify(1e400L, "1e+400");
+	assert_stringify(1.5e-4950L, "1.5e-4950");
+	// Doubles that are not short in long double, unlike their shortest digits
+	assert_stringify(0.1, "0.10000000000000000555");
+	assert_stringify(0.1 + 0.2, "0.3000000000000000444");
+	assert_stringify(-2.5e-300, "-2.4999999999999999798e-300");
+	assert_stringify(34077362267111670.0, "3.4077362267111672e+16");
+	assert_stringify(5e-324, "4.940656458412465442e-324");
+	assert_stringify(std::numeric_limits<double>::max(), "1.7976931348623157081e+308");
+	assert_stringify(std::numeric_limits<long double>::infinity(), "null");
+	assert_stringify(std::numeric_limits<long double>::quiet_NaN(), "null");
+}
+
+void test_stringify_integer_digits() {
+	// Around every change in the number of digits
+	long long power = 1;
+	for(int digits = 1; digits <= 18; digits++) {
+		power *= 10;
+		for(long long n : {power - 1, power, power + 1, -power + 1, -power, -power - 1}) {
+			assert(nosj::stringify(n) == std::to_string(n));
+		}
+	}
+
+	char buffer[21];
+	for(unsigned long long n : {0ULL, 9ULL, 10ULL, 10000000000000000000ULL, 18446744073709551615ULL}) {
+		char* end = nosj::_details::writeUnsigned(n, buffer);
+		assert(std::string(buffer, end) == std::to_string(n));
+	}
+}
+
+void assert_float_round_trip(long double x) {
+	std::string str = nosj::stringify(x);
+	nosj::Value parsed = nosj::parse(str);
+	assert(parsed.isNumber());
+	assert(parsed.asNumber().floatRef() == x);
+}
+
+void test_stringify_number_round_trip() {
+	assert_float_round_trip(0.1);
+	assert_float_round_trip(1.0 / 3);
+	assert_float_round_trip(1.0L / 3);
+	assert_float_round_trip(std::numeric_limits<double>::max());
+	assert_float_round_trip(std::numeric_limits<double>::min());
+	assert_float_round_trip(std::numeric_limits<double>::denorm_min());
+	assert_float_round_trip(std::numeric_limits<long double>::max());
+	assert_float_round_trip(std::numeric_limits<long double>::min());
+	assert_float_round_trip(-std::numeric_limits<long double>::epsilon());
+
+	std::mt19937_64 random(42);
+	for(int i = 0; i < 10000; i++) {
+		std::uint64_t bits = random();
+		double x;
+		std::memcpy(&x, &bits, sizeof(x));
+		if(std::isfinite(x)) {
+			assert_float_round_trip(x);
+		}
+		assert_float_round_trip(std::ldexp(static_cast<long double>(bits), int(random() % 200) - 100));
+	}
+
+	// The shortest digits of doubles, which floats read from up to 17 digits
+	// get: 17 significant digits read back, and fewer never do when the
+	// shortest digits have more than 15
+	std::mt19937_64 random2(7);
+	char digits[32];
+	for(int i = 0; i < 10000; i++) {
+		std::uint64_t bits = random2();
+		double x;
+		std::memcpy(&x, &bits, sizeof(x));
+		if(!std::isfinite(x)  ||  x == 0) {
+			continue;
+		}
+		int precision = 1;
+		for(; precision < 17; precision++) {
+			std::snprintf(digits, sizeof(digits), "%.*g", precision, x);
+			if(std::strtod(digits, nullptr) == x) {
+				break;
+			}
+		}
+		nosj::_details::DecimalFloat decimal = nosj::_details::shortestDecimal(std::fabs(x));
+		assert(int(nosj::_details::countDigits(decimal.digits)) == precision);
+
+		std::snprintf(digits, sizeof(digits), "%.*g", precision, std::fabs(x));
+		long double parsed = std::strtold(digits, nullptr);
+		assert_float_round_trip(parsed);
+		char* end = nosj::_details::writeDecimal(decimal.digits, decimal.exponent, digits);
+		assert(nosj::stringify(parsed) == std::string(digits, end));
+	}
 }
 
 std::string quoted(const std::string& str) {
@@ -275,6 +404,409 @@ void test_stringify_object() {
 	);
 }
 
+template <typename Char>
+std::string unitBytes(const std::basic_string<Char>& str, bool bigEndian) {
+	std::string bytes;
+	for(Char unit : str) {
+		for(size_t i = 0; i < sizeof(Char); i++) {
+			size_t shift = 8 * (bigEndian ? sizeof(Char) - 1 - i : i);
+			bytes += char((static_cast<unsigned long>(unit) >> shift) & 0xFF);
+		}
+	}
+	return bytes;
+}
+
+void test_stringify_encoding() {
+	using nosj::Encoding;
+	const nosj::Value v = nosj::Array{u8"h\u00E9llo \u20AC\U0001F600", 1, nosj::Object{{"k", "\t"}}};
+	const std::string    utf8  = u8"[\"h\u00E9llo \u20AC\U0001F600\",1,{\"k\":\"\\t\"}]";
+	const std::u16string utf16 =  u"[\"h\u00E9llo \u20AC\U0001F600\",1,{\"k\":\"\\t\"}]";
+	const std::u32string utf32 =  U"[\"h\u00E9llo \u20AC\U0001F600\",1,{\"k\":\"\\t\"}]";
+
+	assert(nosj::stringify(v, Encoding::UTF8) == utf8);
+	assert(nosj::stringifyUTF16(v) == utf16);
+	assert(nosj::stringifyUTF32(v) == utf32);
+	assert(nosj::stringify(v, Encoding::UTF16LE) == unitBytes(utf16, false));
+	assert(nosj::stringify(v, Encoding::UTF16BE) == unitBytes(utf16, true));
+	assert(nosj::stringify(v, Encoding::UTF32LE) == unitBytes(utf32, false));
+	assert(nosj::stringify(v, Encoding::UTF32BE) == unitBytes(utf32, true));
+
+	std::ostringstream os;
+	nosj::writeTo(os, v, Encoding::UTF16BE);
+	assert(os.str() == unitBytes(utf16, true));
+
+	const nosj::Value object = nosj::Object{{"a", nosj::Array{1, 2}}, {"b", "c"}};
+	const std::string prettyUTF8 = nosj::stringify(object, true);
+	assert(nosj::stringifyUTF16(object, true) == std::u16string(prettyUTF8.begin(), prettyUTF8.end()));
+	assert(nosj::stringifyUTF32(object, true) == std::u32string(prettyUTF8.begin(), prettyUTF8.end()));
+
+	// Longer than the encoding buffer, with sequences across its boundaries
+	std::string    longUTF8;
+	std::u16string longUTF16;
+	for(int i = 0; i < 3000; i++) {
+		longUTF8  += u8"ab\u00E9\U0001F600 c";
+		longUTF16 +=  u"ab\u00E9\U0001F600 c";
+	}
+	assert(nosj::stringifyUTF16(longUTF8) == u"\"" + longUTF16 + u"\"");
+
+	// Invalid UTF-8
+	assert(nosj::stringifyUTF16("a\xFF" "b") == u"\"a\uFFFDb\"");
+	assert(nosj::stringifyUTF16("a\xE2\x82") == u"\"a\uFFFD\"");
+	assert(nosj::stringifyUTF32("\xED\xA0\x80") == U"\"\uFFFD\uFFFD\uFFFD\"");
+	assert(nosj::stringify("a\xFF", Encoding::UTF8) == "\"a\xFF\"");
+}
+
+void test_stringify_ascii_only() {
+	nosj::StringifyOptions options;
+	options.asciiOnly = true;
+
+	assert(nosj::stringify("abc \"\\\n\x01\x7F", options) == R"("abc \"\\\n\u0001")");
+	assert(nosj::stringify("caf\u00e9 \u20ac", options) == R"("caf\u00E9 \u20AC")");
+	assert(nosj::stringify("\U0001F600", options) == R"("\uD83D\uDE00")");
+	// Invalid or cut short
+	assert(nosj::stringify("a\xFF" "b\xE2\x82", options) == R"("a\uFFFDb\uFFFD")");
+
+	std::string longString = std::string(40, 'a') + "\u00e9" + std::string(40, 'b');
+	nosj::Value v = nosj::Object{{"\u00e9", nosj::Array{longString}}};
+	assert(nosj::stringify(v, options) == R"({"\u00E9":[")" + std::string(40, 'a') + "\\u00E9" + std::string(40, 'b') + "\"]}");
+	assert(nosj::parse(nosj::stringify(v, options)) == v);
+
+	// Long runs are copied as they are otherwise
+	assert(nosj::stringify(longString) == '"' + longString + '"');
+
+	options.pretty = true;
+	assert(nosj::stringify(v, options) == "{\n   \"\\u00E9\" : [\"" + std::string(40, 'a') + "\\u00E9" + std::string(40, 'b') + "\"]\n}");
+}
+
+void test_stringify_layout() {
+	nosj::Value v = nosj::Object{{"a", nosj::Array{
+		nosj::Array{1, 2},
+		nosj::Array{1, 2, 3},
+		nosj::Object{{"b", nosj::emptyObject}},
+		nosj::emptyArray,
+	}}};
+
+	nosj::StringifyOptions options;
+	options.pretty = true;
+	options.indentWidth = 1;
+	options.indentChar = '\t';
+	options.keySeparator = ": ";
+	options.inlineArraySize = 2;
+	options.inlineObjectSize = 1;
+	// The outer object has one member, but not on one line: its value does not fit
+	assert(nosj::stringify(v, options) == "{\"a\":[\n\t[1,2],\n\t[\n\t\t1,\n\t\t2,\n\t\t3\n\t],\n\t{\"b\":{}},\n\t[]\n]}");
+
+	options.inlineArraySize = 0;
+	options.inlineObjectSize = 0;
+	assert(nosj::stringify(v, options) ==
+			"{\n\t\"a\": [\n\t\t[\n\t\t\t1,\n\t\t\t2\n\t\t],\n\t\t[\n\t\t\t1,\n\t\t\t2,\n\t\t\t3\n\t\t],\n"
+			"\t\t{\n\t\t\t\"b\": {}\n\t\t},\n\t\t[]\n\t]\n}");
+	assert(nosj::parse(nosj::stringify(v, options)) == v);
+
+	// The defaults are the layout of stringify(v, true)
+	nosj::StringifyOptions defaults;
+	defaults.pretty = true;
+	assert(nosj::stringify(v, defaults) == nosj::stringify(v, true));
+
+	// Which keeps arrays of one element on one line, whatever the element holds
+	assert_eq(nosj::stringify(nosj::Array{nosj::Array{1}}, true), "[[1]]");
+	assert_eq(nosj::stringify(nosj::Array{nosj::Array{1, 2}}, true), "[[\n   1,\n   2\n]]");
+	assert_eq(nosj::stringify(nosj::Array{nosj::Object{{"a", 1}}}, true), "[{\n   \"a\" : 1\n}]");
+	assert_eq(nosj::stringify(nosj::Object{{"a", nosj::Array{nosj::Array{1, 2}}}}, true),
+	          "{\n   \"a\" : [[\n      1,\n      2\n   ]]\n}");
+	for(auto& value : {nosj::Value(nosj::Array{nosj::Array{1}}), nosj::Value(nosj::Array{nosj::Array{1, 2}}),
+	                   nosj::Value(nosj::Array{nosj::Object{{"a", 1}}})}) {
+		assert(nosj::stringify(value, defaults) == nosj::stringify(value, true));
+	}
+}
+
+void test_stringify_parallel() {
+	// Large containers at the top, nested in small ones, and in the chunks of
+	// large ones, which are written serially
+	nosj::Array rows;
+	for(int i = 0; i < 5000; i++) {
+		rows.push_back(nosj::Object{{"id", i}});
+	}
+	nosj::Object wide;
+	for(int i = 0; i < 2000; i++) {
+		wide["k" + std::to_string(i)] = nosj::Array{i, 0.5 * i, "\n"};
+	}
+	nosj::Array numbers(3000, 7);
+	nosj::Array pairs(1500, nosj::Array{1, 2});
+	pairs.push_back(numbers);
+	nosj::Value v = nosj::Object{{"rows", rows}, {"wide", wide}, {"nested", nosj::Array{numbers, pairs}},
+	                             {"empty", nosj::emptyArray}};
+
+	nosj::StringifyOptions pretty;
+	pretty.pretty = true;
+	nosj::StringifyOptions layout;
+	layout.pretty = true;
+	layout.indentChar = '\t';
+	layout.indentWidth = 1;
+	layout.inlineArraySize = 3;
+	layout.inlineObjectSize = 1;
+	nosj::StringifyOptions inlined;
+	inlined.pretty = true;
+	inlined.inlineArraySize = 100000;
+	for(auto& options : {nosj::StringifyOptions(), pretty, layout, inlined}) {
+		std::string expected = nosj::stringify(v, options);
+		assert(nosj::stringifyParallel(v, 4, options) == expected);
+		assert(nosj::stringifyParallel(v, 1, options) == expected);
+		assert(nosj::stringifyParallel(v, 0, options) == expected);
+		assert(nosj::stringifyParallel(rows, 3, options) == nosj::stringify(rows, options));
+	}
+	assert(nosj::stringifyParallel(nosj::Array{1, 2}, 4) == "[1,2]");
+	assert(nosj::stringifyParallel(nosj::null, 4) == "null");
+}
+
+void test_stringify_cached() {
+	nosj::Array list;
+	for(int i = 0; i < 100; i++) {
+		list.push_back(nosj::Object{{"n", i}});
+	}
+	nosj::Value v = nosj::Object{{"list", list}, {"config", nosj::Object{{"name", "a\nb"}}}};
+
+	nosj::StringifyOptions pretty;
+	pretty.pretty = true;
+	pretty.inlineArraySize = 2;
+
+	for(auto& options : {nosj::StringifyOptions(), pretty}) {
+		nosj::StringifyCache cache(options);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+
+		// Changed in place, replaced, added and removed
+		nosj::Value& config = v.asObject()["config"];
+		nosj::Value& element = v.asObject()["list"].asArray()[50];
+		config.asObject()["name"] = "c";
+		cache.invalidate(config);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+		element.asObject()["n"] = nosj::Array{1, 2, 3};
+		cache.invalidate(element);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+		element.asObject()["n"].asArray()[1] = nosj::Object{{"m", 4}};
+		cache.invalidate(element.asObject()["n"]);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+		element.asObject()["n"].asArray()[1].asObject()["m"] = 5;
+		cache.invalidate(element.asObject()["n"].asArray()[1]);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+		v.asObject()["list"].asArray().push_back(nosj::null);
+		cache.invalidate(v.asObject()["list"]);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+		v.asObject()["list"].asArray().pop_front();
+		cache.invalidate(v.asObject()["list"]);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+		v.asObject()["list"] = nosj::Array{nosj::Array{1}, nosj::Object{{"o", nosj::Array{2, 3, 4}}}};
+		cache.invalidate(v);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+
+		// Values that are not arrays nor objects drop all of it
+		v.asObject()["list"].asArray()[1].asObject()["o"].asArray()[0] = 6;
+		cache.invalidate(v.asObject()["list"].asArray()[1].asObject()["o"].asArray()[0]);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+		v.asObject()["list"].asArray()[0].asArray()[0] = 7;
+		cache.invalidate(v.asObject()["list"].asArray()[0]);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+
+		// The outputs of unchanged containers are copied
+		nosj::Value& o = v.asObject()["list"].asArray()[1].asObject()["o"];
+		o.asArray()[0] = 8; // Not told to the cache
+		assert(cache.stringify(v) != nosj::stringify(v, options));
+		cache.invalidate(o);
+		assert(cache.stringify(v) == nosj::stringify(v, options));
+
+		v.asObject()["list"] = list;
+	}
+
+	// Written with other options
+	nosj::StringifyCache cache;
+	std::string compact = nosj::stringify(v);
+	assert(cache.stringify(v) == compact);
+	cache.options = pretty;
+	assert(cache.stringify(v) == nosj::stringify(v, pretty));
+	cache.options = nosj::StringifyOptions();
+	assert(cache.stringify(v) == compact);
+
+	// Moved to another indentation level, and written as another document
+	nosj::Value doc = nosj::Array{v};
+	cache.options = pretty;
+	assert(cache.stringify(doc) == nosj::stringify(doc, pretty));
+	assert(cache.stringify(doc.asArray()[0]) == nosj::stringify(v, pretty));
+	cache.clear();
+	assert(cache.stringify(doc) == nosj::stringify(doc, pretty));
+
+	// Copies of the document are not known to the cache
+	nosj::Value copy = doc;
+	copy.asArray()[0].asObject()["config"] = 1;
+	assert(cache.stringify(copy) == nosj::stringify(copy, pretty));
+	assert(cache.stringify(doc) == nosj::stringify(doc, pretty));
+}
+
+void test_stringify_sized() {
+	std::string longString = std::string(300, 'a') + "\n\u00e9\x01" + std::string(100, 'b');
+	nosj::Value v = nosj::Object{{"a", nosj::Array{
+		nosj::null, true, -1234567, std::numeric_limits<long long>::min(), 0.1, 1e300, "\"\\\t", longString,
+		nosj::Array{nosj::Object{{"b", nosj::emptyArray}}, nosj::emptyObject},
+	}}};
+
+	nosj::StringifyOptions pretty;
+	pretty.pretty = true;
+	nosj::StringifyOptions ascii;
+	ascii.asciiOnly = true;
+	nosj::StringifyOptions tabs;
+	tabs.pretty = true;
+	tabs.indentChar = '\t';
+	tabs.indentWidth = 1;
+	for(auto& options : {nosj::StringifyOptions(), pretty, ascii, tabs}) {
+		std::string expected = nosj::stringify(v, options);
+		assert_eq(nosj::serializedSize(v, options), expected.size());
+		assert(nosj::parse(expected) == v);
+
+		std::vector<char> buffer(expected.size() + 1, '#');
+		assert_eq(nosj::stringifyTo(buffer.data(), expected.size(), v, options), expected.size());
+		assert(std::string(buffer.data(), expected.size()) == expected);
+		assert(buffer.back() == '#');
+
+		// Too small: a prefix, and nothing past the capacity
+		std::fill(buffer.begin(), buffer.end(), '#');
+		assert_eq(nosj::stringifyTo(buffer.data(), 10, v, options), expected.size());
+		assert(std::string(buffer.data(), 10) == expected.substr(0, 10));
+		assert(buffer[10] == '#');
+	}
+
+	assert_eq(nosj::serializedSize(nosj::null), 4u);
+	assert_eq(nosj::serializedSize(nosj::emptyArray, true), 2u);
+
+	// The widths of numbers, which are not formatted to be sized
+	std::mt19937_64 random(3);
+	for(int i = 0; i < 10000; i++) {
+		std::uint64_t bits = random();
+		double x;
+		std::memcpy(&x, &bits, sizeof(x));
+		long long n = static_cast<long long>(bits) >> (random() % 64);
+		for(const nosj::Value& number : {nosj::Value(x), nosj::Value(std::ldexp(static_cast<long double>(bits), -64)),
+		                                 nosj::Value(n), nosj::Value(std::ldexp(1.0, int(random() % 2000) - 1000))}) {
+			std::ostringstream os;
+			nosj::writeTo(os, number);
+			assert_eq(nosj::serializedSize(number), os.str().size());
+		}
+	}
+	assert_eq(nosj::stringifyTo(nullptr, 0, "abc"), 5u);
+	// Numbers are formatted in scratch space past the end of a full buffer
+	char number[3];
+	assert_eq(nosj::stringifyTo(number, sizeof(number), 0.5), 3u);
+	assert(std::string(number, 3) == "0.5");
+}
+
+// What the function writes to a pipe
+template <typename Function>
+std::string readPiped(Function write) {
+	int fds[2];
+	assert(pipe(fds) == 0);
+	std::string piped;
+	std::thread reader([&]() {
+		char chunk[4096];
+		ssize_t count;
+		while((count = read(fds[0], chunk, sizeof(chunk))) > 0) {
+			piped.append(chunk, count);
+		}
+	});
+	write(fds[1]);
+	close(fds[1]);
+	reader.join();
+	close(fds[0]);
+	return piped;
+}
+
+void test_stringify_sinks() {
+	nosj::Value v = nosj::Array{1, "two\n", nosj::Array{nosj::null, true, -3.5}, std::string(100000, 'x')};
+	std::string expected = nosj::stringify(v);
+
+	// Appended to what the string holds
+	std::string str = "> ";
+	{
+		nosj::StringSink sink(str);
+		nosj::writeTo(sink, v);
+		assert(sink.size() == 2 + expected.size());
+		sink.flush();
+		assert(str == "> " + expected);
+		sink.put('!');
+	}
+	assert(str == "> " + expected + "!");
+
+	// Too small a buffer, which gets what fits
+	std::vector<char> buffer(50);
+	nosj::FixedBufferSink small(buffer.data(), buffer.size());
+	nosj::writeTo(small, v);
+	small.flush();
+	assert(!small.fits());
+	assert(small.size() == expected.size());
+	assert(std::string(buffer.data(), 20) == expected.substr(0, 20));
+
+	std::ostringstream os;
+	{
+		nosj::StreamSink sink(os);
+		nosj::writeTo(sink, v, true);
+	}
+	assert(os.str() == nosj::stringify(v, true));
+
+	// The stream keeps its format flags
+	os.str("");
+	os << nosj::Value("\x1F") << ' ' << 31;
+	assert(os.str() == R"("\u001F" 31)");
+
+	std::string piped = readPiped([&](int fd) {
+		nosj::FileDescriptorSink sink(fd);
+		nosj::writeTo(sink, v);
+		sink.flush();
+	});
+	assert(piped == expected);
+
+	nosj::FileDescriptorSink closed(-1);
+	try {
+		nosj::writeTo(closed, v);
+		closed.flush();
+		assert(false);
+	} catch(nosj::WriteError& e) {
+		assert(e.error == EBADF);
+	}
+}
+
+void test_stringify_gather_sink() {
+	// Long runs, referenced, between escapes and other values, copied
+	std::string blob(3 * 1024 * 1024, 'A');
+	blob[1000000] = '\n';
+	nosj::Value v = nosj::Array{nosj::Object{{"blob", blob}}, 1, std::string(5000, 'b') + '"', "short", blob};
+	for(bool pretty : {false, true}) {
+		std::string expected = nosj::stringify(v, pretty);
+		std::string piped = readPiped([&](int fd) {
+			nosj::GatherSink sink(fd);
+			nosj::writeTo(sink, v, pretty);
+			sink.flush();
+			// Reused after a flush
+			nosj::writeTo(sink, v, pretty);
+		});
+		assert(piped == expected + expected);
+	}
+
+	// Many segments
+	nosj::Value array = nosj::Array(3000, std::string(5000, 'c'));
+	std::string piped = readPiped([&](int fd) {
+		nosj::GatherSink sink(fd);
+		nosj::writeTo(sink, array);
+	});
+	assert(piped == nosj::stringify(array));
+
+	nosj::GatherSink closed(-1);
+	try {
+		nosj::writeTo(closed, v);
+		closed.flush();
+		assert(false);
+	} catch(nosj::WriteError& e) {
+		assert(e.error == EBADF);
+	}
+}
+
 }
 
 namespace tests {
@@ -282,8 +814,18 @@ namespace tests {
 		TEST(stringify_null);
 		TEST(stringify_boolean);
 		TEST(stringify_number);
+		TEST(stringify_integer_digits);
+		TEST(stringify_number_round_trip);
 		TEST(stringify_string);
 		TEST(stringify_array);
 		TEST(stringify_object);
+		TEST(stringify_encoding);
+		TEST(stringify_ascii_only);
+		TEST(stringify_layout);
+		TEST(stringify_parallel);
+		TEST(stringify_cached);
+		TEST(stringify_sized);
+		TEST(stringify_sinks);
+		TEST(stringify_gather_sink);
 	}
 }
@@ -0,0 +1,183 @@
+#include "nosj-test.hpp"
+#include "nosj/writer.hpp"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace /*unnamed*/ {
+
+// Writes the value with the Writer calls for each of its parts
+template <typename Sink>
+void writeParts(nosj::Writer<Sink>& writer, const nosj::Value& v) {
+	switch(v.type()) {
+	case nosj::Value::ArrayValue:
+		writer.beginArray();
+		for(auto& element : v.asArray()) {
+			writeParts(writer, element);
+		}
+		writer.endArray();
+		break;
+	case nosj::Value::ObjectValue:
+		writer.beginObject();
+		for(auto& member : v.asObject()) {
+			writer.key(member.first);
+			writeParts(writer, member.second);
+		}
+		writer.endObject();
+		break;
+	default:
+		writer.value(v);
+	}
+}
+
+// Compact, pretty, and pretty with another layout
+std::vector<nosj::StringifyOptions> layouts() {
+	std::vector<nosj::StringifyOptions> layouts(3);
+	layouts[1].pretty = true;
+	layouts[2].pretty = true;
+	layouts[2].indentWidth = 1;
+	layouts[2].indentChar = '\t';
+	layouts[2].keySeparator = ": ";
+	layouts[2].inlineArraySize = 3;
+	layouts[2].inlineObjectSize = 2;
+	return layouts;
+}
+
+void assert_written_like_stringify(const nosj::Value& v) {
+	for(auto& options : layouts()) {
+		std::string str;
+		nosj::StringSink sink(str);
+		{
+			nosj::Writer<nosj::StringSink> writer(sink, options);
+			writeParts(writer, v);
+			assert(writer.complete());
+		}
+		sink.flush();
+		assert(str == nosj::stringify(v, options));
+	}
+}
+
+void test_writer_like_stringify() {
+	assert_written_like_stringify(nosj::null);
+	assert_written_like_stringify(-12);
+	assert_written_like_stringify(nosj::emptyArray);
+	assert_written_like_stringify(nosj::emptyObject);
+	assert_written_like_stringify(nosj::Array{1});
+	assert_written_like_stringify(nosj::Array{nosj::Array{nosj::Array{1, 2}}});
+	assert_written_like_stringify(nosj::Array{nosj::Array{nosj::Array{1, 2}}, nosj::Array{nosj::Array{3}, 4, 5, 6}});
+	assert_written_like_stringify(nosj::Object{{"a", nosj::Object{{"b", nosj::Array{1, 2}}}}});
+	assert_written_like_stringify(nosj::Array{nosj::Object{{"a", nosj::Array{1, nosj::Array{2}}}, {"b", 3}}});
+	assert_written_like_stringify(nosj::Array{1, nosj::Array{2, 3}, nosj::Array{nosj::Object{{"c", "d\n"}}}});
+	assert_written_like_stringify(nosj::Object{
+			{"name", "John"},
+			{"children", nosj::Array{nosj::Object{{"age", 12.5}, {"toys", nosj::emptyArray}}}},
+			{"married", true},
+			{"spouse", nosj::null},
+			{"nested", nosj::Array{nosj::Array{nosj::Object{{"x", nosj::Array{1, 2}}}}, 3}},
+	});
+}
+
+void test_writer_scalars() {
+	std::string str;
+	nosj::StringSink sink(str);
+	nosj::Writer<nosj::StringSink> writer(sink);
+	writer.beginArray()
+		.null().value(true).value(false).value(-3).value(std::numeric_limits<std::uint64_t>::max())
+		.value(std::numeric_limits<std::int64_t>::min()).value(0.5).value(2.0f).value('A')
+		.value("a\"b").value(std::string("c")).value(nosj::Value(nosj::Array{1, 2}))
+		.beginObject().key("k").value(1).key(std::string("l")).beginArray().endArray().endObject()
+		.endArray();
+	assert(writer.complete());
+	writer.flush();
+	sink.flush();
+	assert(str == R"([null,true,false,-3,18446744073709551615,-9223372036854775808,0.5,2.0,65,"a\"b","c",[1,2],{"k":1,"l":[]}])");
+}
+
+void test_writer_large() {
+	std::string str;
+	nosj::StringSink sink(str);
+	{
+		nosj::StringifyOptions options;
+		options.pretty = true;
+		nosj::Writer<nosj::StringSink> writer(sink, options);
+		writer.beginArray();
+		for(int i = 0; i < 10000; i++) {
+			writer.beginObject().key("item").beginArray().value(i).beginArray().value("x").endArray().endArray().endObject();
+		}
+		writer.endArray();
+	}
+	sink.flush();
+
+	nosj::Array array;
+	for(int i = 0; i < 10000; i++) {
+		array.push_back(nosj::Object{{"item", nosj::Array{i, nosj::Array{"x"}}}});
+	}
+	assert(str == nosj::stringify(array, true));
+}
+
+void test_writer_nested_lines() {
+	nosj::StringifyOptions options;
+	options.pretty = true;
+	std::string str;
+	nosj::StringSink sink(str);
+
+	// A container on one line holds back the lines of the one inside it until
+	// its end, and gives them their indentation then
+	for(int shape = 0; shape < 3; shape++) {
+		nosj::Array inner;
+		for(int i = 0; i < 200000; i++) {
+			inner.push_back(i);
+		}
+		nosj::Value array = shape == 0 ? nosj::Array{std::move(inner)}
+		                  : shape == 1 ? nosj::Array{std::move(inner), nosj::Array{1, 2}}
+		                  : nosj::Array{1, nosj::Array{std::move(inner)}};
+		str.clear();
+		{
+			nosj::Writer<nosj::StringSink> writer(sink, options);
+			writeParts(writer, array);
+		}
+		sink.flush();
+		assert(str == nosj::stringify(array, true));
+	}
+
+	// One on lines passes its lines on
+	str.clear();
+	{
+		nosj::Writer<nosj::StringSink> writer(sink, options);
+		writer.beginArray().value(0).beginArray();
+		for(int i = 0; i < 2000; i++) {
+			writer.value(i);
+			if(i == 1000) {
+				writer.flush();
+				sink.flush();
+				assert(str.size() > 1000);
+			}
+		}
+		writer.endArray().endArray();
+	}
+	sink.flush();
+
+	// Whole values in held containers
+	for(auto& value : {nosj::Value(nosj::Array{nosj::Array{1, 2}}), nosj::Value(nosj::Object{{"a", nosj::Array{1, 2}}})}) {
+		str.clear();
+		{
+			nosj::Writer<nosj::StringSink> writer(sink, options);
+			writer.beginArray().beginObject().key("b").value(value).endObject().endArray();
+		}
+		sink.flush();
+		nosj::Value expected = nosj::Array{nosj::Object{{"b", value}}};
+		assert(str == nosj::stringify(expected, true));
+	}
+}
+
+}
+
+namespace tests {
+	void writer() {
+		TEST(writer_like_stringify);
+		TEST(writer_scalars);
+		TEST(writer_large);
+		TEST(writer_nested_lines);
+	}
+}
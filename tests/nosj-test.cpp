@@ -70,6 +70,11 @@ namespace tests {
 	void value_visitor();
 	void stringify();
 	void parse();
+	void file();
+	void lazy();
+	void literal();
+	void index();
+	void writer();
 }
 
 
@@ -86,6 +91,11 @@ int main() {
 	tests::value_visitor();
 	tests::stringify();
 	tests::parse();
+	tests::file();
+	tests::lazy();
+	tests::literal();
+	tests::index();
+	tests::writer();
 
 	cout << endl;
 	cout << "PASSED: " << coloredCount(passedCount, GREEN) << endl;
@@ -0,0 +1,54 @@
+// Writes the index of the elements of a JSON array or NDJSON file, for
+// nosj::FileIndex::load()
+#include "nosj/index.hpp"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace /*unnamed*/ {
+
+int usage() {
+	std::cerr << "Usage: nosj-index [--lines] [--key MEMBER] FILE [INDEX_FILE]" << std::endl;
+	std::cerr << "The index is written to FILE.index by default." << std::endl;
+	return 2;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	nosj::FileIndex::Layout layout = nosj::FileIndex::Layout::Array;
+	std::string keyMember;
+	std::string path, indexPath;
+
+	for(int i = 1; i < argc; i++) {
+		if(std::strcmp(argv[i], "--lines") == 0) {
+			layout = nosj::FileIndex::Layout::Lines;
+		} else if(std::strcmp(argv[i], "--key") == 0  &&  i + 1 < argc) {
+			keyMember = argv[++i];
+		} else if(argv[i][0] == '-') {
+			return usage();
+		} else if(path.empty()) {
+			path = argv[i];
+		} else if(indexPath.empty()) {
+			indexPath = argv[i];
+		} else {
+			return usage();
+		}
+	}
+	if(path.empty()) {
+		return usage();
+	}
+	if(indexPath.empty()) {
+		indexPath = path + ".index";
+	}
+
+	try {
+		nosj::FileIndex index = nosj::FileIndex::build(path, layout, keyMember);
+		index.save(indexPath);
+		std::cout << index.size() << " elements indexed in " << indexPath << std::endl;
+	} catch(std::exception& e) {
+		std::cerr << path << ": " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}